@@ -1,105 +1,290 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
-
-#define MAX_PROCESSES 10
-#define MAX_RESOURCES 10
-
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "vector_kernels.h"
+
+#define VECTOR_WIDTH 8      // ints per 256-bit vector; rows are padded to a multiple of this
+
+/*
+Matrices are heap allocated and row-major with rows padded to VECTOR_WIDTH
+ints (padding stays zero), so a process's row is one aligned, contiguous
+vector for any number of resources. element (i, j) is m[i * stride + j].
+
+The state remembers the last safe sequence it proved. A request by process p
+only lowers `available` for the processes ordered before p; after p runs the
+work vector is exactly what it was before. So a request is checked by
+replaying the sequence up to p with the reduced work, moving p earlier if it
+can already finish there, which is O(position(p) * R). Only when that replay
+fails does the full check run. Releases never break the sequence.
+*/
 typedef struct {
     int processes;
     int resources;
+    int stride;                 // row length in ints
 
     // Main matrices
-    int allocation[MAX_PROCESSES][MAX_RESOURCES];
-    int max[MAX_PROCESSES][MAX_RESOURCES];
-    int need[MAX_PROCESSES][MAX_RESOURCES];
-    int available[MAX_RESOURCES];
+    int *allocation;
+    int *max;
+    int *need;
+    int *available;
 
     // For tracking safe sequence
-    int safe_sequence[MAX_PROCESSES];
-    bool finished[MAX_PROCESSES];
+    int *safe_sequence;
+    int *sequence_pos;          // index of each process in safe_sequence
+    bool sequence_valid;        // safe_sequence is a proof for the current state
+    bool *finished;
+
+    // scratch for the safety checks
+    int *work;
+    int *order;
+    int *ready;
+    int *wait_heap;             // per resource, processes blocked on it, min-heap on need
+    int *wait_count;
+    int blocked;                // processes currently parked in a wait heap
 } BankerSystem;
 
 
+typedef enum {
+    REQUEST_GRANTED,
+    REQUEST_EXCEEDS_NEED,
+    REQUEST_UNAVAILABLE,
+    REQUEST_UNSAFE,
+    REQUEST_INVALID_RELEASE
+} RequestResult;
+
+
+static int *row(const BankerSystem *bs, int *matrix, int process_id) {
+    return matrix + (size_t)process_id * bs->stride;
+}
+
+
+static void *alloc_vectors(size_t count) {
+    size_t bytes = (count * sizeof(int) + 31) & ~(size_t)31;
+    void *p = aligned_alloc(32, bytes ? bytes : 32);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+
+void freeBankers(BankerSystem *bs) {
+    free(bs->allocation);
+    free(bs->max);
+    free(bs->need);
+    free(bs->available);
+    free(bs->safe_sequence);
+    free(bs->sequence_pos);
+    free(bs->finished);
+    free(bs->work);
+    free(bs->order);
+    free(bs->ready);
+    free(bs->wait_heap);
+    free(bs->wait_count);
+    memset(bs, 0, sizeof(BankerSystem));
+}
+
+
 // initialize
-void initializeBankers(BankerSystem* bs, int p, int r) {
+bool initializeBankers(BankerSystem* bs, int p, int r) {
+    memset(bs, 0, sizeof(BankerSystem));
     bs->processes = p;
     bs->resources = r;
-
-    for (int i = 0; i < p; ++i) {
-        for (int j = 0; j < r; ++j) {
-            bs->allocation[i][j] = 0;
-            bs->allocation[i][j] = 0;
-            bs->need[i][j] = 0;
-        }
-        bs->finished[i] = false;
+    bs->stride = (r + VECTOR_WIDTH - 1) / VECTOR_WIDTH * VECTOR_WIDTH;
+
+    size_t cells = (size_t)p * bs->stride;
+    bs->allocation = alloc_vectors(cells);
+    bs->max = alloc_vectors(cells);
+    bs->need = alloc_vectors(cells);
+    bs->available = alloc_vectors(bs->stride);
+    bs->work = alloc_vectors(bs->stride);
+    bs->safe_sequence = calloc(p, sizeof(int));
+    bs->sequence_pos = calloc(p, sizeof(int));
+    bs->order = calloc(p, sizeof(int));
+    bs->ready = calloc(p, sizeof(int));
+    bs->finished = calloc(p, sizeof(bool));
+    bs->wait_heap = calloc((size_t)p * r, sizeof(int));
+    bs->wait_count = calloc(r, sizeof(int));
+
+    if (!bs->allocation || !bs->max || !bs->need || !bs->available || !bs->work ||
+        !bs->safe_sequence || !bs->sequence_pos || !bs->order || !bs->ready ||
+        !bs->finished || !bs->wait_heap || !bs->wait_count) {
+        freeBankers(bs);
+        return false;
     }
 
-    for (int i = 0; i < r; ++i) {
-        bs->available[i] = 0;
-    }
+    return true;
 }
 
 
 void calNeed(BankerSystem* bs) {
     for (int i = 0; i < bs->processes; ++i) {
-        for (int j = 0; j < bs->resources; ++j) {
-            bs->need[i][j] = bs->max[i][j] - bs->allocation[i][j];
+        int *max = row(bs, bs->max, i);
+        int *allocation = row(bs, bs->allocation, i);
+        int *need = row(bs, bs->need, i);
+
+        for (int j = 0; j < bs->stride; ++j) {
+            need[j] = max[j] - allocation[j];
         }
     }
-}
 
+    bs->sequence_valid = false;
+}
 
 
 // check if resources can be allocated to a process
 bool canAllocateResources(BankerSystem* bs, int process_id, int work[]) {
-    for (int i = 0; i < bs->resources; ++i) {
-        if (bs->need[process_id][i] > work[i]) {
-            return false;
-        }
+    return activeKernels->lessEqual(row(bs, bs->need, process_id), work, bs->stride);
+}
+
+
+static void heapPush(BankerSystem *bs, int resource, int process_id) {
+    int *heap = bs->wait_heap + (size_t)resource * bs->processes;
+    int i = bs->wait_count[resource]++;
+    bs->blocked++;
+    int key = row(bs, bs->need, process_id)[resource];
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (row(bs, bs->need, heap[parent])[resource] <= key) break;
+        heap[i] = heap[parent];
+        i = parent;
     }
-    return true;
+    heap[i] = process_id;
 }
 
 
-// safety algorithm
-bool isSafe(BankerSystem* bs) {
-    int work[MAX_RESOURCES];
-    int completed = 0;
+static int heapPop(BankerSystem *bs, int resource) {
+    int *heap = bs->wait_heap + (size_t)resource * bs->processes;
+    int top = heap[0];
+    int last = heap[--bs->wait_count[resource]];
+    int n = bs->wait_count[resource];
+    bs->blocked--;
+    int key = row(bs, bs->need, last)[resource];
+    int i = 0;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && row(bs, bs->need, heap[child + 1])[resource] <
+                             row(bs, bs->need, heap[child])[resource]) child++;
+        if (row(bs, bs->need, heap[child])[resource] >= key) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n > 0) heap[i] = last;
 
-    for (int i = 0; i < bs->resources; ++i) {
-        work[i] = bs->available[i];
+    return top;
+}
+
+
+// resume checking a process from resource `from`: park it on the first resource it
+// still lacks, or mark it ready; resources before `from` are already known to fit
+static void parkProcess(BankerSystem *bs, int process_id, int from, int *ready_count) {
+    int j = activeKernels->firstGreater(row(bs, bs->need, process_id), bs->work, from, bs->resources);
+
+    if (j < bs->resources) {
+        heapPush(bs, j, process_id);
+    } else {
+        bs->ready[(*ready_count)++] = process_id;
     }
+}
+
+
+/*
+Full safety check. Instead of rescanning every process until nothing changes
+(O(P^2 * R)), each unfinished process waits on the first resource it lacks,
+in a per-resource heap ordered by need. When a finished process returns its
+allocation, only the heaps of resources that grew are popped, and a woken
+process resumes its scan where it stopped. Each process's scan moves forward
+through the R resources at most once: O(P * R) plus the heap operations.
+On success the new safe sequence replaces the cached one.
+*/
+static bool checkSafe(BankerSystem *bs) {
+    int ready_count = 0;
+    int completed = 0;
+
+    memcpy(bs->work, bs->available, bs->stride * sizeof(int));
+    memset(bs->wait_count, 0, bs->resources * sizeof(int));
+    bs->blocked = 0;
 
-    // reset
     for (int i = 0; i < bs->processes; ++i) {
-        bs->finished[i] = false;        
+        bs->finished[i] = false;
+        parkProcess(bs, i, 0, &ready_count);
+    }
+
+    while (ready_count > 0) {
+        int i = bs->ready[--ready_count];
+        const int *allocation = row(bs, bs->allocation, i);
+
+        bs->order[completed++] = i;
+        bs->finished[i] = true;
+
+        activeKernels->add(bs->work, allocation, bs->stride);
+
+        for (int j = 0; bs->blocked > 0 && j < bs->resources; ++j) {
+            while (bs->wait_count[j] > 0 &&
+                   row(bs, bs->need, bs->wait_heap[(size_t)j * bs->processes])[j] <= bs->work[j]) {
+                parkProcess(bs, heapPop(bs, j), j + 1, &ready_count);
+            }
+        }
     }
 
-    // find a safe sequence
-    while (completed < bs->processes) {
-        bool found = false;
+    if (completed < bs->processes) return false;
 
-        for (int i = 0; i < bs->processes; ++i) {
-            if (!bs->finished[i] && canAllocateResources(bs, i, work)) {
-                // add process to safe sequence
-                bs->safe_sequence[completed] = i;
+    memcpy(bs->safe_sequence, bs->order, bs->processes * sizeof(int));
+    for (int k = 0; k < bs->processes; ++k) {
+        bs->sequence_pos[bs->safe_sequence[k]] = k;
+    }
+    bs->sequence_valid = true;
+
+    return true;
+}
 
-                // add allocated resources back to work
-                for (int j = 0; j < bs->resources; ++j) {
-                    work[j] += bs->allocation[i][j];
-                }
 
-                bs->finished[i] = true;
-                completed++;
-                found = true;
+/*
+Re-verify the cached sequence after process_id's request was applied. Walks
+the sequence up to process_id with the reduced work; as soon as process_id
+itself fits it is moved to that position. Everything after it sees at least
+the work it had before, so the rest of the sequence still holds.
+*/
+static bool checkSafeIncremental(BankerSystem *bs, int process_id) {
+    const VectorKernels *kernels = activeKernels;
+    const int *need = row(bs, bs->need, process_id);
+    int pos = bs->sequence_pos[process_id];
+
+    memcpy(bs->work, bs->available, bs->stride * sizeof(int));
+
+    for (int k = 0; k <= pos; ++k) {
+        if (kernels->lessEqual(need, bs->work, bs->stride)) {
+            memmove(&bs->safe_sequence[k + 1], &bs->safe_sequence[k], (pos - k) * sizeof(int));
+            bs->safe_sequence[k] = process_id;
+            for (int m = k; m <= pos; ++m) {
+                bs->sequence_pos[bs->safe_sequence[m]] = m;
             }
+            return true;
         }
 
-        if (!found) {
-            printf("System is not in safe state\n");
+        int q = bs->safe_sequence[k];
+        if (q == process_id || !kernels->lessEqual(row(bs, bs->need, q), bs->work, bs->stride)) {
             return false;
         }
+        kernels->add(bs->work, row(bs, bs->allocation, q), bs->stride);
+    }
+
+    return false;
+}
+
+
+// safety algorithm
+bool isSafe(BankerSystem* bs) {
+    if (!checkSafe(bs)) {
+        printf("System is not in safe state\n");
+        return false;
     }
 
     printf("System is in safe state.\nSafe sequence: ");
@@ -112,42 +297,364 @@ bool isSafe(BankerSystem* bs) {
 }
 
 
-// Resource request algorithm
-bool requestResources(BankerSystem* bs, int process_id, int request[]) {
-    // Check if request is valid
+static RequestResult validateRequest(BankerSystem* bs, int process_id, const int request[]) {
+    const int *need = row(bs, bs->need, process_id);
+
     for (int i = 0; i < bs->resources; ++i) {
-        if (request[i] > bs->need[process_id][i]) {
-            printf("Error: process has exceeded its max\n");
-            return false;
-        }
-        if (request[i] > bs->available[i]) {
-            printf("Error: resoureces not avaible\n");
-            return false;
-        }
+        if (request[i] > need[i]) return REQUEST_EXCEEDS_NEED;
+        if (request[i] > bs->available[i]) return REQUEST_UNAVAILABLE;
     }
+    return REQUEST_GRANTED;
+}
+
+
+// move request from available to the process (sign 1) or back (sign -1)
+static void applyRequest(BankerSystem* bs, int process_id, const int request[], int sign) {
+    int *allocation = row(bs, bs->allocation, process_id);
+    int *need = row(bs, bs->need, process_id);
 
-    // Try to allocate resources
     for (int i = 0; i < bs->resources; ++i) {
-        bs->available[i] -= request[i];
-        bs->allocation[process_id][i] += request[i];
-        bs->need[process_id][i] -= request[i];
+        bs->available[i] -= sign * request[i];
+        allocation[i] += sign * request[i];
+        need[i] -= sign * request[i];
     }
+}
+
+
+// Resource request algorithm, without printing
+RequestResult tryRequestResources(BankerSystem* bs, int process_id, const int request[]) {
+    // Check if request is valid
+    RequestResult result = validateRequest(bs, process_id, request);
+    if (result != REQUEST_GRANTED) return result;
+
+    // Try to allocate resources
+    applyRequest(bs, process_id, request, 1);
 
-    // check if resulting state is safe
-    if (isSafe(bs)) {
+    // check if resulting state is safe, cheaply first
+    if (bs->sequence_valid && checkSafeIncremental(bs, process_id)) return REQUEST_GRANTED;
+    if (checkSafe(bs)) return REQUEST_GRANTED;
+
+    // if not safe, rollback changes; the cached sequence is untouched and still valid
+    applyRequest(bs, process_id, request, -1);
+
+    return REQUEST_UNSAFE;
+}
+
+
+bool requestResources(BankerSystem* bs, int process_id, int request[]) {
+    switch (tryRequestResources(bs, process_id, request)) {
+    case REQUEST_GRANTED:
         printf("Resources allocated successfully to Process %d\n", process_id);
         return true;
+    case REQUEST_EXCEEDS_NEED:
+        printf("Error: process has exceeded its max\n");
+        return false;
+    case REQUEST_UNAVAILABLE:
+        printf("Error: resoureces not avaible\n");
+        return false;
+    default:
+        printf("Request denied: Would lead to unsafe state!\n");
+        return false;
     }
-    
-    // if not safe, rollback changes
+}
+
+
+// return resources; a release never invalidates the cached safe sequence
+bool releaseResources(BankerSystem* bs, int process_id, const int release[]) {
+    const int *allocation = row(bs, bs->allocation, process_id);
+
     for (int i = 0; i < bs->resources; ++i) {
-        bs->available[i] += request[i];
-        bs->allocation[process_id][i] -= request[i];
-        bs->need[process_id][i] += request[i];
+        if (release[i] < 0 || release[i] > allocation[i]) return false;
+    }
+
+    applyRequest(bs, process_id, release, -1);
+
+    return true;
+}
+
+
+/*
+Admission controller: a thread-safe front end for one BankerSystem.
+
+Callers never take a lock to submit. Each call pushes a ticket onto a
+lock-free stack and then either waits for it to be decided or, if nobody is
+combining, becomes the combiner (flat combining): it takes every pending
+ticket at once and decides the whole batch against the BankerSystem, which
+only the combiner ever touches.
+
+Within a batch each request is first tried on its own with the incremental
+check. Requests it cannot prove safe are set aside, then applied together
+and decided by a single full safety check; only if that batch is unsafe are
+they retried one at a time. Nothing on this path prints.
+*/
+#define LATENCY_BUCKETS 40                  // log2(ns) histogram
+
+typedef struct AdmissionTicket {
+    struct AdmissionTicket *next;
+    int process_id;
+    bool release;
+    const int *vector;
+    RequestResult result;
+    atomic_bool done;
+} AdmissionTicket;
+
+
+typedef struct {
+    atomic_long count;
+    atomic_long total_ns;
+    atomic_long max_ns;
+    atomic_long histogram[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+
+typedef struct {
+    atomic_long requests;
+    atomic_long releases;
+    atomic_long granted;
+    atomic_long exceeds_need;
+    atomic_long unavailable;
+    atomic_long unsafe;
+    atomic_long invalid_release;
+    atomic_long batches;
+    atomic_long batched_tickets;
+    atomic_long full_checks;
+    LatencyHistogram request_latency;
+    LatencyHistogram release_latency;
+} AdmissionStats;
+
+
+typedef struct {
+    BankerSystem *bs;
+    _Atomic(AdmissionTicket*) pending;
+    pthread_mutex_t combiner;
+    AdmissionTicket **deferred;             // combiner-only scratch, one slot per batched ticket
+    size_t deferred_capacity;
+    AdmissionStats stats;
+} AdmissionController;
+
+
+bool initAdmissionController(AdmissionController *ctrl, BankerSystem *bs) {
+    memset(ctrl, 0, sizeof(AdmissionController));
+    ctrl->bs = bs;
+    atomic_init(&ctrl->pending, NULL);
+    pthread_mutex_init(&ctrl->combiner, NULL);
+
+    // prove the starting state once so later requests can go incremental
+    return checkSafe(bs);
+}
+
+
+void destroyAdmissionController(AdmissionController *ctrl) {
+    pthread_mutex_destroy(&ctrl->combiner);
+    free(ctrl->deferred);
+}
+
+
+static void decideBatch(AdmissionController *ctrl, AdmissionTicket *list) {
+    BankerSystem *bs = ctrl->bs;
+    size_t deferred = 0;
+    size_t count = 0;
+
+    // the stack hands tickets over newest first; decide them in arrival order
+    AdmissionTicket *ordered = NULL;
+    while (list) {
+        AdmissionTicket *next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+        count++;
+    }
+
+    if (count > ctrl->deferred_capacity) {
+        AdmissionTicket **grown = realloc(ctrl->deferred, count * sizeof(AdmissionTicket*));
+        if (grown) {
+            ctrl->deferred = grown;
+            ctrl->deferred_capacity = count;
+        }
+    }
+
+    for (AdmissionTicket *t = ordered; t; t = t->next) {
+        if (t->release) {
+            t->result = releaseResources(bs, t->process_id, t->vector) ? REQUEST_GRANTED : REQUEST_INVALID_RELEASE;
+            continue;
+        }
+
+        t->result = validateRequest(bs, t->process_id, t->vector);
+        if (t->result != REQUEST_GRANTED) continue;
+
+        applyRequest(bs, t->process_id, t->vector, 1);
+        if (bs->sequence_valid && checkSafeIncremental(bs, t->process_id)) continue;
+        applyRequest(bs, t->process_id, t->vector, -1);
+
+        if (deferred < ctrl->deferred_capacity) {
+            ctrl->deferred[deferred++] = t;
+        } else {
+            atomic_fetch_add_explicit(&ctrl->stats.full_checks, 1, memory_order_relaxed);
+            t->result = tryRequestResources(bs, t->process_id, t->vector);
+        }
+    }
+
+    if (deferred > 0) {
+        // one full check for everything the incremental check could not prove
+        size_t applied = 0;
+        for (size_t i = 0; i < deferred; ++i) {
+            AdmissionTicket *t = ctrl->deferred[i];
+            if (validateRequest(bs, t->process_id, t->vector) != REQUEST_GRANTED) break;
+            applyRequest(bs, t->process_id, t->vector, 1);
+            applied++;
+        }
+
+        atomic_fetch_add_explicit(&ctrl->stats.full_checks, 1, memory_order_relaxed);
+        if (applied == deferred && checkSafe(bs)) {
+            deferred = 0;
+        } else {
+            while (applied > 0) {
+                AdmissionTicket *t = ctrl->deferred[--applied];
+                applyRequest(bs, t->process_id, t->vector, -1);
+            }
+            for (size_t i = 0; i < deferred; ++i) {
+                AdmissionTicket *t = ctrl->deferred[i];
+                atomic_fetch_add_explicit(&ctrl->stats.full_checks, 1, memory_order_relaxed);
+                t->result = tryRequestResources(bs, t->process_id, t->vector);
+            }
+        }
+    }
+
+    atomic_fetch_add_explicit(&ctrl->stats.batches, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ctrl->stats.batched_tickets, count, memory_order_relaxed);
+
+    // the waiter may reuse its ticket as soon as done is set, so read next first
+    while (ordered) {
+        AdmissionTicket *next = ordered->next;
+        atomic_store_explicit(&ordered->done, true, memory_order_release);
+        ordered = next;
+    }
+}
+
+
+static RequestResult submitTicket(AdmissionController *ctrl, AdmissionTicket *ticket) {
+    atomic_init(&ticket->done, false);
+
+    AdmissionTicket *head = atomic_load_explicit(&ctrl->pending, memory_order_relaxed);
+    do {
+        ticket->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&ctrl->pending, &head, ticket,
+                                                    memory_order_release, memory_order_relaxed));
+
+    while (!atomic_load_explicit(&ticket->done, memory_order_acquire)) {
+        if (pthread_mutex_trylock(&ctrl->combiner) == 0) {
+            AdmissionTicket *batch = atomic_exchange_explicit(&ctrl->pending, NULL, memory_order_acquire);
+            if (batch) decideBatch(ctrl, batch);
+            pthread_mutex_unlock(&ctrl->combiner);
+        } else {
+            sched_yield();
+        }
+    }
+
+    return ticket->result;
+}
+
+
+static long elapsedNs(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+}
+
+
+static void recordLatency(LatencyHistogram *latency, long ns) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (1L << (bucket + 1)) <= ns) bucket++;
+
+    atomic_fetch_add_explicit(&latency->histogram[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&latency->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&latency->total_ns, ns, memory_order_relaxed);
+
+    long max = atomic_load_explicit(&latency->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&latency->max_ns, &max, ns,
+                                                              memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+
+// thread-safe request; blocks until its batch is decided
+RequestResult admitRequest(AdmissionController *ctrl, int process_id, const int request[]) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    AdmissionTicket ticket = { .process_id = process_id, .release = false, .vector = request };
+    RequestResult result = submitTicket(ctrl, &ticket);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    recordLatency(&ctrl->stats.request_latency, elapsedNs(&start, &end));
+
+    AdmissionStats *stats = &ctrl->stats;
+    atomic_fetch_add_explicit(&stats->requests, 1, memory_order_relaxed);
+    switch (result) {
+    case REQUEST_GRANTED:      atomic_fetch_add_explicit(&stats->granted, 1, memory_order_relaxed); break;
+    case REQUEST_EXCEEDS_NEED: atomic_fetch_add_explicit(&stats->exceeds_need, 1, memory_order_relaxed); break;
+    case REQUEST_UNAVAILABLE:  atomic_fetch_add_explicit(&stats->unavailable, 1, memory_order_relaxed); break;
+    default:                   atomic_fetch_add_explicit(&stats->unsafe, 1, memory_order_relaxed); break;
+    }
+
+    return result;
+}
+
+
+// thread-safe release, ordered with requests through the same batches
+bool admitRelease(AdmissionController *ctrl, int process_id, const int release[]) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    AdmissionTicket ticket = { .process_id = process_id, .release = true, .vector = release };
+    bool ok = submitTicket(ctrl, &ticket) == REQUEST_GRANTED;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    recordLatency(&ctrl->stats.release_latency, elapsedNs(&start, &end));
+
+    atomic_fetch_add_explicit(&ctrl->stats.releases, 1, memory_order_relaxed);
+    if (!ok) atomic_fetch_add_explicit(&ctrl->stats.invalid_release, 1, memory_order_relaxed);
+    return ok;
+}
+
+
+// latency below which `fraction` of calls completed, from the log2 histogram
+static long latencyPercentile(LatencyHistogram *latency, double fraction) {
+    long total = atomic_load(&latency->count);
+    long target = (long)(total * fraction);
+    long seen = 0;
+
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += atomic_load(&latency->histogram[b]);
+        if (seen > target) return 1L << (b + 1);
     }
+    return atomic_load(&latency->max_ns);
+}
+
+
+static void printLatency(const char *label, LatencyHistogram *latency) {
+    long count = atomic_load(&latency->count);
 
-    printf("Request denied: Would lead to unsafe state!\n");
-    return false;    
+    printf("  %s latency avg %.1f us, p50 < %.1f us, p99 < %.1f us, max %.1f us\n", label,
+           count ? atomic_load(&latency->total_ns) / 1e3 / count : 0.0,
+           latencyPercentile(latency, 0.50) / 1e3, latencyPercentile(latency, 0.99) / 1e3,
+           atomic_load(&latency->max_ns) / 1e3);
+}
+
+
+void printAdmissionStats(AdmissionController *ctrl) {
+    AdmissionStats *stats = &ctrl->stats;
+    long requests = atomic_load(&stats->requests);
+    long batches = atomic_load(&stats->batches);
+
+    printf("  %ld requests: %ld granted, rejected %ld unsafe / %ld unavailable / %ld over max\n",
+           requests, atomic_load(&stats->granted), atomic_load(&stats->unsafe),
+           atomic_load(&stats->unavailable), atomic_load(&stats->exceeds_need));
+    printf("  %ld releases, %ld invalid\n",
+           atomic_load(&stats->releases), atomic_load(&stats->invalid_release));
+    printLatency("request", &stats->request_latency);
+    printLatency("release", &stats->release_latency);
+    printf("  %ld batches, %.2f tickets/batch, %ld full safety checks\n",
+           batches, batches ? (double)atomic_load(&stats->batched_tickets) / batches : 0.0,
+           atomic_load(&stats->full_checks));
 }
 
 
@@ -159,7 +666,7 @@ void printSystemState(BankerSystem *bs) {
     printf("\nAllocation Matrix:\n");
     for(int i = 0; i < bs->processes; i++) {
         for(int j = 0; j < bs->resources; j++) {
-            printf("%d ", bs->allocation[i][j]);
+            printf("%d ", bs->allocation[i * bs->stride + j]);
         }
         printf("\n");
     }
@@ -167,7 +674,7 @@ void printSystemState(BankerSystem *bs) {
     printf("\nMax Matrix:\n");
     for(int i = 0; i < bs->processes; i++) {
         for(int j = 0; j < bs->resources; j++) {
-            printf("%d ", bs->max[i][j]);
+            printf("%d ", bs->max[i * bs->stride + j]);
         }
         printf("\n");
     }
@@ -175,7 +682,7 @@ void printSystemState(BankerSystem *bs) {
     printf("\nNeed Matrix:\n");
     for(int i = 0; i < bs->processes; i++) {
         for(int j = 0; j < bs->resources; j++) {
-            printf("%d ", bs->need[i][j]);
+            printf("%d ", bs->need[i * bs->stride + j]);
         }
         printf("\n");
     }
@@ -188,12 +695,237 @@ void printSystemState(BankerSystem *bs) {
 }
 
 
+static double elapsed_us(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+
+// admission latency with thousands of processes and hundreds of resource types
+void benchmarkAdmission(int processes, int resources, int operations) {
+    BankerSystem bs;
+    if (!initializeBankers(&bs, processes, resources)) return;
+
+    srand(1);
+    for (int i = 0; i < processes; ++i) {
+        for (int j = 0; j < resources; ++j) {
+            int max = rand() % 10;
+            bs.max[i * bs.stride + j] = max;
+            bs.allocation[i * bs.stride + j] = max ? rand() % (max + 1) : 0;
+        }
+    }
+    for (int j = 0; j < resources; ++j) {
+        bs.available[j] = 7;
+    }
+    calNeed(&bs);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool safe = checkSafe(&bs);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double full_us = elapsed_us(&start, &end);
+
+    int *request = calloc(resources, sizeof(int));
+    int *release = calloc(resources, sizeof(int));
+    if (!request || !release || !safe) {
+        free(request);
+        free(release);
+        freeBankers(&bs);
+        return;
+    }
+
+    int granted = 0, unsafe = 0, other = 0;
+    double request_us = 0, worst_us = 0;
+
+    for (int op = 0; op < operations; ++op) {
+        int pid = rand() % processes;
+
+        if (op % 4 == 0) {
+            // a process finishes and hands back everything it holds
+            memcpy(release, &bs.allocation[(size_t)pid * bs.stride], resources * sizeof(int));
+            releaseResources(&bs, pid, release);
+            continue;
+        }
+
+        const int *need = &bs.need[(size_t)pid * bs.stride];
+        for (int j = 0; j < resources; ++j) {
+            request[j] = (need[j] > 0 && rand() % 4 == 0) ? 1 + rand() % need[j] : 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        RequestResult result = tryRequestResources(&bs, pid, request);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double us = elapsed_us(&start, &end);
+        request_us += us;
+        if (us > worst_us) worst_us = us;
+
+        if (result == REQUEST_GRANTED) granted++;
+        else if (result == REQUEST_UNSAFE) unsafe++;
+        else other++;
+    }
+
+    int requests = granted + unsafe + other;
+    printf("P=%d R=%d: full check %.0f us, request avg %.1f us (worst %.0f us); "
+           "%d granted, %d unsafe, %d unavailable\n",
+           processes, resources, full_us, request_us / requests, worst_us, granted, unsafe, other);
+
+    free(request);
+    free(release);
+    freeBankers(&bs);
+}
+
+
+typedef struct {
+    AdmissionController *ctrl;
+    int first_process;      // each worker drives its own slice of processes
+    int process_count;
+    int operations;
+    unsigned seed;
+} AdmissionWorker;
+
+
+static void *admissionWorker(void *arg) {
+    AdmissionWorker *w = arg;
+    BankerSystem *bs = w->ctrl->bs;
+    int *vector = calloc(bs->resources, sizeof(int));
+    if (!vector) return NULL;
+
+    for (int op = 0; op < w->operations; ++op) {
+        int pid = w->first_process + rand_r(&w->seed) % w->process_count;
+
+        // need/allocation rows of our own processes only change through our own tickets
+        if (op % 4 == 0) {
+            memcpy(vector, &bs->allocation[(size_t)pid * bs->stride], bs->resources * sizeof(int));
+            admitRelease(w->ctrl, pid, vector);
+            continue;
+        }
+
+        const int *need = &bs->need[(size_t)pid * bs->stride];
+        for (int j = 0; j < bs->resources; ++j) {
+            vector[j] = (need[j] > 0 && rand_r(&w->seed) % 4 == 0) ? 1 + rand_r(&w->seed) % need[j] : 0;
+        }
+        admitRequest(w->ctrl, pid, vector);
+    }
+
+    free(vector);
+    return NULL;
+}
+
+
+// many threads submitting through one controller
+void benchmarkAdmissionController(int processes, int resources, int threads, int operations) {
+    BankerSystem bs;
+    if (!initializeBankers(&bs, processes, resources)) return;
+
+    srand(1);
+    for (int i = 0; i < processes; ++i) {
+        for (int j = 0; j < resources; ++j) {
+            int max = rand() % 10;
+            bs.max[i * bs.stride + j] = max;
+            bs.allocation[i * bs.stride + j] = max ? rand() % (max + 1) : 0;
+        }
+    }
+    for (int j = 0; j < resources; ++j) {
+        bs.available[j] = 7;
+    }
+    calNeed(&bs);
+
+    AdmissionController ctrl;
+    if (!initAdmissionController(&ctrl, &bs)) {
+        freeBankers(&bs);
+        return;
+    }
+
+    pthread_t tids[threads];
+    AdmissionWorker workers[threads];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; ++t) {
+        workers[t] = (AdmissionWorker){ &ctrl, t * (processes / threads), processes / threads,
+                                        operations / threads, 100u + t };
+        pthread_create(&tids[t], NULL, admissionWorker, &workers[t]);
+    }
+    for (int t = 0; t < threads; ++t) {
+        pthread_join(tids[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("P=%d R=%d, %d threads: %.0f ops/sec\n", processes, resources, threads,
+           operations / (elapsed_us(&start, &end) / 1e6));
+    printAdmissionStats(&ctrl);
+
+    destroyAdmissionController(&ctrl);
+    freeBankers(&bs);
+}
+
+
+// ns per call of each kernel for R = 8..1024, worst case (need fits everywhere, full scan)
+void benchmarkKernels(void) {
+    const VectorKernels *sets[] = {
+        &scalarKernels,
+#ifdef HAVE_AVX2_KERNELS
+        &avx2Kernels,
+#endif
+    };
+    int set_count = sizeof(sets) / sizeof(sets[0]);
+    int *need = alloc_vectors(1024);
+    int *work = alloc_vectors(1024);
+    if (!need || !work) {
+        free(need);
+        free(work);
+        return;
+    }
+
+    for (int j = 0; j < 1024; ++j) {
+        need[j] = j % 7;
+        work[j] = 8;
+    }
+
+    printf("\nKernel ns/call (active: %s)\n   R", activeKernels->name);
+    for (int k = 0; k < set_count; ++k) {
+        printf("  %7s <=  %7s add", sets[k]->name, sets[k]->name);
+    }
+    printf("\n");
+
+    for (int r = 8; r <= 1024; r *= 2) {
+        int iterations = (1 << 24) / r;
+        printf("%4d", r);
+
+        for (int k = 0; k < set_count; ++k) {
+            struct timespec start, end;
+            volatile int sink = 0;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int it = 0; it < iterations; ++it) {
+                sink += sets[k]->lessEqual(need, work, r);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double le_ns = elapsed_us(&start, &end) * 1e3 / iterations;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int it = 0; it < iterations; ++it) {
+                sets[k]->add(work, need, r);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double add_ns = elapsed_us(&start, &end) * 1e3 / iterations;
+
+            printf("  %10.1f  %11.1f", le_ns, add_ns);
+        }
+        printf("\n");
+    }
+
+    free(need);
+    free(work);
+}
+
+
 int main() {
     BankerSystem bs;
     int processes = 5;
     int resources = 3;
     
-    initializeBankers(&bs, processes, resources);
+    if (!initializeBankers(&bs, processes, resources)) return 1;
     
     // Initialize Available Resources
     bs.available[0] = 3;
@@ -221,8 +953,8 @@ int main() {
     // Set up initial state
     for(int i = 0; i < processes; i++) {
         for(int j = 0; j < resources; j++) {
-            bs.allocation[i][j] = allocation[i][j];
-            bs.max[i][j] = max[i][j];
+            bs.allocation[i * bs.stride + j] = allocation[i][j];
+            bs.max[i * bs.stride + j] = max[i][j];
         }
     }
     
@@ -237,7 +969,18 @@ int main() {
     printf("\nTesting resource request...\n");
     int request[3] = {1, 0, 2};
     requestResources(&bs, 1, request);
+    freeBankers(&bs);
+
+    printf("\nAdmission benchmark:\n");
+    benchmarkAdmission(1000, 64, 20000);
+    benchmarkAdmission(4000, 256, 20000);
+
+    benchmarkKernels();
+
+    printf("\nAdmission controller:\n");
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        benchmarkAdmissionController(4000, 256, threads, 40000);
+    }
     
     return 0;
 }
-
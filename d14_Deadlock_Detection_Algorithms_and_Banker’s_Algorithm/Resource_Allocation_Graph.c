@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "vector_kernels.h"
+
 #define MAX_PROCESSES 10
 #define MAX_RESOURCES 10
 
@@ -35,8 +37,9 @@ void initializeRAG(ResourceGraph* graph, int p, int r) {
 
 // Check for cycle in the graph (deadlock detection)
 int detectDeadLock(ResourceGraph* graph) {
+    const VectorKernels *kernels = activeKernels;
     int work[MAX_RESOURCES];
-    int finish[MAX_RESOURCES] = {0};
+    int finish[MAX_PROCESSES] = {0};
     int deadlock = 0;
 
     // Initialize work array
@@ -49,21 +52,10 @@ int detectDeadLock(ResourceGraph* graph) {
     do {
         found = 0;
         for (int i = 0; i < graph->processes; ++i) {
-            int canComplete = 1;
-
             // Check if process can complete with available resoures
-            for (int j = 0; j < graph->resources; ++j) {
-                if (graph->request[i][j] > work[j]) {
-                    canComplete = 0;
-                    break;
-                }
-            }
-
-            if (canComplete) {
+            if (!finish[i] && kernels->lessEqual(graph->request[i], work, graph->resources)) {
                 // Process can complete, release its resource
-                for (int j = 0; j < graph->resources; ++j) {
-                    work[j] += graph->allocation[i][j];
-                }
+                kernels->add(work, graph->allocation[i], graph->resources);
                 finish[i] = 1;
                 found = 1;
             }
@@ -1,5 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 
 #define MAX_PROCESSES 10
 
@@ -58,6 +62,468 @@ int detectDeadLock(WaitForGraph* graph) {
 }
 
 
+/*
+Sparse wait-for graph for long-running systems. Processes (or threads) are
+added and removed at runtime and only edges that exist are stored, in
+per-node out/in lists.
+
+Deadlock is checked incrementally when a wait edge is added, using the
+Pearce-Kelly dynamic topological order: every node has a position ord[] such
+that each edge points from a lower to a higher position. Adding waiter ->
+holder with ord[waiter] < ord[holder] cannot close a cycle and costs O(1).
+Otherwise only the nodes whose positions lie between the two endpoints are
+searched: forward from holder (a path back to waiter is the deadlock) and
+backward from waiter, then those two sets swap positions. Removing edges
+or nodes never breaks the order. All public calls take the graph lock, so
+threads can check inline before blocking.
+*/
+typedef struct {
+    int *items;
+    int count;
+    int capacity;
+} IntList;
+
+
+typedef struct {
+    pthread_mutex_t lock;
+    int capacity;
+    int *ord;                   // topological position, -1 for a free id
+    int *parent;                // forward-search tree, to report the cycle
+    unsigned *mark;             // visit stamp of the current search
+    IntList *out;               // waits for
+    IntList *in;                // waited on by
+    IntList free_ids;
+    int next_ord;
+    unsigned stamp;
+    int node_count;
+
+    // scratch for addWaitEdge
+    IntList stack;
+    IntList forward;
+    IntList backward;
+    IntList cycle;              // last deadlock found, waiter first
+    long long *keys;
+    int key_capacity;
+} SparseWaitForGraph;
+
+
+static int listPush(IntList *list, int value) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int *items = realloc(list->items, capacity * sizeof(int));
+        if (!items) return -1;
+
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    list->items[list->count++] = value;
+    return 0;
+}
+
+
+// remove one occurrence, order does not matter
+static void listRemove(IntList *list, int value) {
+    for (int i = 0; i < list->count; ++i) {
+        if (list->items[i] == value) {
+            list->items[i] = list->items[--list->count];
+            return;
+        }
+    }
+}
+
+
+SparseWaitForGraph *createSparseWFG(void) {
+    SparseWaitForGraph *graph = calloc(1, sizeof(SparseWaitForGraph));
+    if (!graph) return NULL;
+
+    pthread_mutex_init(&graph->lock, NULL);
+    return graph;
+}
+
+
+void destroySparseWFG(SparseWaitForGraph *graph) {
+    for (int i = 0; i < graph->capacity; ++i) {
+        free(graph->out[i].items);
+        free(graph->in[i].items);
+    }
+
+    free(graph->ord);
+    free(graph->parent);
+    free(graph->mark);
+    free(graph->out);
+    free(graph->in);
+    free(graph->free_ids.items);
+    free(graph->stack.items);
+    free(graph->forward.items);
+    free(graph->backward.items);
+    free(graph->cycle.items);
+    free(graph->keys);
+    pthread_mutex_destroy(&graph->lock);
+    free(graph);
+}
+
+
+static int growNodes(SparseWaitForGraph *graph) {
+    int capacity = graph->capacity ? graph->capacity * 2 : 64;
+
+    int *ord = realloc(graph->ord, capacity * sizeof(int));
+    if (ord) graph->ord = ord;
+    int *parent = realloc(graph->parent, capacity * sizeof(int));
+    if (parent) graph->parent = parent;
+    unsigned *mark = realloc(graph->mark, capacity * sizeof(unsigned));
+    if (mark) graph->mark = mark;
+    IntList *out = realloc(graph->out, capacity * sizeof(IntList));
+    if (out) graph->out = out;
+    IntList *in = realloc(graph->in, capacity * sizeof(IntList));
+    if (in) graph->in = in;
+
+    if (!ord || !parent || !mark || !out || !in) return -1;
+
+    for (int i = graph->capacity; i < capacity; ++i) {
+        graph->ord[i] = -1;
+        graph->mark[i] = 0;
+        memset(&graph->out[i], 0, sizeof(IntList));
+        memset(&graph->in[i], 0, sizeof(IntList));
+    }
+    for (int i = capacity - 1; i >= graph->capacity; --i) {
+        if (listPush(&graph->free_ids, i) < 0) return -1;
+    }
+
+    graph->capacity = capacity;
+    return 0;
+}
+
+
+static int compareKeys(const void *a, const void *b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+
+// renumber live nodes 0..n-1 in their current order once positions run out
+static void compactOrder(SparseWaitForGraph *graph) {
+    int n = 0;
+    for (int v = 0; v < graph->capacity; ++v) {
+        if (graph->ord[v] >= 0) graph->keys[n++] = ((long long)graph->ord[v] << 32) | v;
+    }
+    qsort(graph->keys, n, sizeof(long long), compareKeys);
+
+    for (int i = 0; i < n; ++i) {
+        graph->ord[graph->keys[i] & 0xFFFFFFFF] = i;
+    }
+    graph->next_ord = n;
+}
+
+
+static int ensureKeys(SparseWaitForGraph *graph, int needed) {
+    if (needed <= graph->key_capacity) return 0;
+
+    long long *keys = realloc(graph->keys, needed * sizeof(long long));
+    if (!keys) return -1;
+
+    graph->keys = keys;
+    graph->key_capacity = needed;
+    return 0;
+}
+
+
+// new process; returns its id, or -1 without memory
+int addProcessWFG(SparseWaitForGraph *graph) {
+    pthread_mutex_lock(&graph->lock);
+
+    if (graph->free_ids.count == 0 && growNodes(graph) < 0) {
+        pthread_mutex_unlock(&graph->lock);
+        return -1;
+    }
+    if (ensureKeys(graph, graph->capacity) < 0) {
+        pthread_mutex_unlock(&graph->lock);
+        return -1;
+    }
+    if (graph->next_ord == INT_MAX) compactOrder(graph);
+
+    int id = graph->free_ids.items[--graph->free_ids.count];
+    graph->ord[id] = graph->next_ord++;     // no edges yet, any fresh position works
+    graph->node_count++;
+
+    pthread_mutex_unlock(&graph->lock);
+    return id;
+}
+
+
+// drop a process and every wait edge touching it
+void removeProcessWFG(SparseWaitForGraph *graph, int id) {
+    pthread_mutex_lock(&graph->lock);
+
+    if (id >= 0 && id < graph->capacity && graph->ord[id] >= 0) {
+        for (int i = 0; i < graph->out[id].count; ++i) listRemove(&graph->in[graph->out[id].items[i]], id);
+        for (int i = 0; i < graph->in[id].count; ++i) listRemove(&graph->out[graph->in[id].items[i]], id);
+        graph->out[id].count = 0;
+        graph->in[id].count = 0;
+        graph->ord[id] = -1;
+        graph->node_count--;
+        listPush(&graph->free_ids, id);
+    }
+
+    pthread_mutex_unlock(&graph->lock);
+}
+
+
+// give the nodes of both search sets the sorted positions they occupied, backward set first
+static void reorder(SparseWaitForGraph *graph) {
+    int nb = graph->backward.count, nf = graph->forward.count;
+    long long *keys = graph->keys;
+
+    for (int i = 0; i < nb; ++i) keys[i] = ((long long)graph->ord[graph->backward.items[i]] << 32) | graph->backward.items[i];
+    for (int i = 0; i < nf; ++i) keys[nb + i] = ((long long)graph->ord[graph->forward.items[i]] << 32) | graph->forward.items[i];
+
+    // each set keeps its internal order
+    qsort(keys, nb, sizeof(long long), compareKeys);
+    qsort(keys + nb, nf, sizeof(long long), compareKeys);
+
+    // the pool of positions is the union of both, ascending; hand them out in set order
+    int *nodes = graph->stack.items;    // stack is empty after the searches, reuse it
+    for (int i = 0; i < nb + nf; ++i) nodes[i] = (int)(keys[i] & 0xFFFFFFFF);
+    for (int i = 0; i < nb + nf; ++i) keys[i] = graph->ord[nodes[i]];
+    qsort(keys, nb + nf, sizeof(long long), compareKeys);
+
+    for (int i = 0; i < nb + nf; ++i) graph->ord[nodes[i]] = (int)keys[i];
+}
+
+
+/*
+Record that waiter is blocked on holder. Returns 0 if the edge was added,
+1 if it would close a cycle (deadlock; the edge is not added and the cycle
+is left in graph->cycle), -1 on a bad id or out of memory.
+*/
+int addWaitEdge(SparseWaitForGraph *graph, int waiter, int holder) {
+    pthread_mutex_lock(&graph->lock);
+    int result = 0;
+
+    if (waiter < 0 || holder < 0 || waiter >= graph->capacity || holder >= graph->capacity ||
+        graph->ord[waiter] < 0 || graph->ord[holder] < 0) {
+        result = -1;
+        goto out;
+    }
+
+    graph->cycle.count = 0;
+    if (waiter == holder) {
+        listPush(&graph->cycle, waiter);
+        result = 1;
+        goto out;
+    }
+
+    int lower = graph->ord[holder];
+    int upper = graph->ord[waiter];
+
+    if (lower < upper) {
+        // a long-lived graph wraps the counter; old marks must not look current
+        if (++graph->stamp == 0) {
+            memset(graph->mark, 0, graph->capacity * sizeof(unsigned));
+            graph->stamp = 1;
+        }
+        unsigned stamp = graph->stamp;
+        graph->forward.count = 0;
+        graph->backward.count = 0;
+
+        // forward from holder through positions below the waiter's: reaching the waiter is a cycle
+        graph->stack.count = 0;
+        graph->mark[holder] = stamp;
+        graph->parent[holder] = -1;
+        listPush(&graph->stack, holder);
+        while (graph->stack.count > 0) {
+            int n = graph->stack.items[--graph->stack.count];
+            listPush(&graph->forward, n);
+
+            for (int i = 0; i < graph->out[n].count; ++i) {
+                int w = graph->out[n].items[i];
+                if (w == waiter) {
+                    // holder -> ... -> n -> waiter, plus the new waiter -> holder edge
+                    listPush(&graph->cycle, waiter);
+                    int start = graph->cycle.count;
+                    for (int v = n; v >= 0; v = graph->parent[v]) listPush(&graph->cycle, v);
+                    for (int a = start, b = graph->cycle.count - 1; a < b; ++a, --b) {
+                        int tmp = graph->cycle.items[a];
+                        graph->cycle.items[a] = graph->cycle.items[b];
+                        graph->cycle.items[b] = tmp;
+                    }
+                    result = 1;
+                    goto out;
+                }
+                if (graph->mark[w] != stamp && graph->ord[w] < upper) {
+                    graph->mark[w] = stamp;
+                    graph->parent[w] = n;
+                    listPush(&graph->stack, w);
+                }
+            }
+        }
+
+        // backward from waiter through positions above the holder's
+        graph->mark[waiter] = stamp;
+        listPush(&graph->stack, waiter);
+        while (graph->stack.count > 0) {
+            int n = graph->stack.items[--graph->stack.count];
+            listPush(&graph->backward, n);
+
+            for (int i = 0; i < graph->in[n].count; ++i) {
+                int u = graph->in[n].items[i];
+                if (graph->mark[u] != stamp && graph->ord[u] > lower) {
+                    graph->mark[u] = stamp;
+                    listPush(&graph->stack, u);
+                }
+            }
+        }
+
+        // reorder reuses the stack as scratch, make sure it is large enough
+        while (graph->stack.capacity < graph->forward.count + graph->backward.count) {
+            if (listPush(&graph->stack, 0) < 0) {
+                result = -1;
+                goto out;
+            }
+        }
+        graph->stack.count = 0;
+        reorder(graph);
+    }
+
+    if (listPush(&graph->out[waiter], holder) < 0 || listPush(&graph->in[holder], waiter) < 0) {
+        listRemove(&graph->out[waiter], holder);
+        result = -1;
+    }
+
+out:
+    pthread_mutex_unlock(&graph->lock);
+    return result;
+}
+
+
+// waiter got what it was waiting for
+void removeWaitEdge(SparseWaitForGraph *graph, int waiter, int holder) {
+    pthread_mutex_lock(&graph->lock);
+
+    if (waiter >= 0 && holder >= 0 && waiter < graph->capacity && holder < graph->capacity) {
+        listRemove(&graph->out[waiter], holder);
+        listRemove(&graph->in[holder], waiter);
+    }
+
+    pthread_mutex_unlock(&graph->lock);
+}
+
+
+// full DFS over the sparse graph, for comparison with the incremental check
+int detectDeadLockSparse(SparseWaitForGraph *graph) {
+    pthread_mutex_lock(&graph->lock);
+
+    // mark: 0 unvisited, 1 on the DFS path, 2 done; parent holds the next edge index to try
+    unsigned *state = graph->mark;
+    int *next_edge = graph->parent;
+    int found = 0;
+
+    for (int v = 0; v < graph->capacity; ++v) state[v] = 0;
+
+    for (int root = 0; root < graph->capacity && !found; ++root) {
+        if (graph->ord[root] < 0 || state[root]) continue;
+
+        graph->stack.count = 0;
+        listPush(&graph->stack, root);
+        state[root] = 1;
+        next_edge[root] = 0;
+
+        while (graph->stack.count > 0 && !found) {
+            int n = graph->stack.items[graph->stack.count - 1];
+            if (next_edge[n] < graph->out[n].count) {
+                int w = graph->out[n].items[next_edge[n]++];
+                if (state[w] == 1) {
+                    found = 1;
+                } else if (state[w] == 0) {
+                    state[w] = 1;
+                    next_edge[w] = 0;
+                    listPush(&graph->stack, w);
+                }
+            } else {
+                state[n] = 2;
+                graph->stack.count--;
+            }
+        }
+    }
+
+    // the incremental search compares stamps against a fresh counter
+    for (int v = 0; v < graph->capacity; ++v) state[v] = 0;
+    graph->stamp = 0;
+
+    pthread_mutex_unlock(&graph->lock);
+    return found;
+}
+
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+
+/*
+Tens of thousands of threads, each blocked on at most one other thread at a
+time: a random thread either stops waiting or starts waiting on a random
+thread. Every wait is checked inline; every 1000th step the full DFS
+confirms the graph the incremental check accepted is still acyclic.
+*/
+void benchmarkSparseWFG(int threads, int steps) {
+    SparseWaitForGraph *graph = createSparseWFG();
+    int *waiting_on = malloc(threads * sizeof(int));
+    if (!graph || !waiting_on) return;
+
+    for (int i = 0; i < threads; ++i) {
+        addProcessWFG(graph);
+        waiting_on[i] = -1;
+    }
+
+    srand(3);
+    long adds = 0, deadlocks = 0, mismatches = 0, longest_cycle = 0;
+    double add_ns = 0, dfs_ns = 0;
+    int dfs_runs = 0;
+    struct timespec start, end;
+
+    for (int step = 0; step < steps; ++step) {
+        int t = rand() % threads;
+
+        if (waiting_on[t] >= 0) {
+            removeWaitEdge(graph, t, waiting_on[t]);
+            waiting_on[t] = -1;
+        } else {
+            int h = rand() % threads;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int result = addWaitEdge(graph, t, h);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            add_ns += elapsed_ns(&start, &end);
+            adds++;
+
+            if (result == 0) {
+                waiting_on[t] = h;
+            } else if (result == 1) {
+                deadlocks++;
+                if (graph->cycle.count > longest_cycle) longest_cycle = graph->cycle.count;
+            }
+        }
+
+        if (step % 1000 == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (detectDeadLockSparse(graph)) mismatches++;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            dfs_ns += elapsed_ns(&start, &end);
+            dfs_runs++;
+        }
+    }
+
+    printf("%d threads, %d steps: %.0f ns per inline check vs %.0f ns per full DFS\n",
+           threads, steps, add_ns / adds, dfs_ns / dfs_runs);
+    printf("  %ld waits checked, %ld deadlocks refused (longest cycle %ld), %ld cycles missed\n",
+           adds, deadlocks, longest_cycle, mismatches);
+
+    free(waiting_on);
+    destroySparseWFG(graph);
+}
+
+
 int main() {
     WaitForGraph graph;
     int p = 4;
@@ -78,6 +544,25 @@ int main() {
     } else {
         printf("No deadlock detected.\n");
     }
+
+    // same scenario on the sparse graph, checked as each wait is added
+    SparseWaitForGraph *sparse = createSparseWFG();
+    if (!sparse) return 1;
+
+    int pid[4];
+    for (int i = 0; i < 4; ++i) pid[i] = addProcessWFG(sparse);
+
+    addWaitEdge(sparse, pid[0], pid[1]);
+    addWaitEdge(sparse, pid[1], pid[2]);
+    addWaitEdge(sparse, pid[2], pid[3]);
+    if (addWaitEdge(sparse, pid[3], pid[0]) == 1) {
+        printf("Deadlock refused inline, cycle:");
+        for (int i = 0; i < sparse->cycle.count; ++i) printf(" %d", sparse->cycle.items[i]);
+        printf("\n");
+    }
+    destroySparseWFG(sparse);
+
+    benchmarkSparseWFG(50000, 2000000);
     
     return 0;    
 }
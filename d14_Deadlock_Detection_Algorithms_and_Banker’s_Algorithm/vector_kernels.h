@@ -0,0 +1,125 @@
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
+
+/*
+Resource-vector kernels shared by the Banker's and resource-allocation-graph
+checks: "need <= work" for every resource, the first resource where need
+exceeds work, and "work += allocation". Each has a portable scalar version
+and, on x86, an AVX2 version compiled with a target attribute so the rest of
+the file does not need -mavx2. The AVX2 set is picked once at startup if the
+CPU supports it; callers go through activeKernels.
+*/
+typedef struct VectorKernels {
+    const char *name;
+    bool (*lessEqual)(const int *a, const int *b, int n);
+    int (*firstGreater)(const int *a, const int *b, int from, int n);
+    void (*add)(int *dst, const int *src, int n);
+} VectorKernels;
+
+
+static bool vectorLessEqualScalar(const int *a, const int *b, int n) {
+    for (int j = 0; j < n; ++j) {
+        if (a[j] > b[j]) return false;
+    }
+    return true;
+}
+
+
+// first j >= from with a[j] > b[j], or n
+static int vectorFirstGreaterScalar(const int *a, const int *b, int from, int n) {
+    for (int j = from; j < n; ++j) {
+        if (a[j] > b[j]) return j;
+    }
+    return n;
+}
+
+
+static void vectorAddScalar(int *dst, const int *src, int n) {
+    for (int j = 0; j < n; ++j) {
+        dst[j] += src[j];
+    }
+}
+
+
+static const VectorKernels scalarKernels = {
+    "scalar", vectorLessEqualScalar, vectorFirstGreaterScalar, vectorAddScalar
+};
+
+
+#ifdef HAVE_AVX2_KERNELS
+__attribute__((target("avx2")))
+static bool vectorLessEqualAVX2(const int *a, const int *b, int n) {
+    int j = 0;
+
+    for (; j + 8 <= n; j += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + j));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        __m256i over = _mm256_cmpgt_epi32(va, vb);
+        if (!_mm256_testz_si256(over, over)) return false;
+    }
+    for (; j < n; ++j) {
+        if (a[j] > b[j]) return false;
+    }
+    return true;
+}
+
+
+__attribute__((target("avx2")))
+static int vectorFirstGreaterAVX2(const int *a, const int *b, int from, int n) {
+    int j = from;
+
+    for (; j + 8 <= n; j += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + j));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(va, vb)));
+        if (mask) return j + __builtin_ctz(mask);
+    }
+    for (; j < n; ++j) {
+        if (a[j] > b[j]) return j;
+    }
+    return n;
+}
+
+
+__attribute__((target("avx2")))
+static void vectorAddAVX2(int *dst, const int *src, int n) {
+    int j = 0;
+
+    for (; j + 8 <= n; j += 8) {
+        __m256i vd = _mm256_loadu_si256((const __m256i*)(dst + j));
+        __m256i vs = _mm256_loadu_si256((const __m256i*)(src + j));
+        _mm256_storeu_si256((__m256i*)(dst + j), _mm256_add_epi32(vd, vs));
+    }
+    for (; j < n; ++j) {
+        dst[j] += src[j];
+    }
+}
+
+
+static const VectorKernels avx2Kernels = {
+    "avx2", vectorLessEqualAVX2, vectorFirstGreaterAVX2, vectorAddAVX2
+};
+#endif
+
+
+static const VectorKernels *activeKernels = &scalarKernels;
+
+
+__attribute__((constructor))
+static void selectVectorKernels(void) {
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        activeKernels = &avx2Kernels;
+    }
+#endif
+}
+
+#endif
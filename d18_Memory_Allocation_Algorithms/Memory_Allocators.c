@@ -1,14 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #define BLOCK_SIZE 256
 #define NUM_BLOCKS 64
 #define MAX_ORDER  10
+#define BITMAP_MAX_LEVELS 6     // 64^6 blocks is far beyond any fixed allocator
+#define LATENCY_BUCKETS 16      // bucket b holds operations that took [2^(b-1), 2^b) ns
+#define LATENCY_SAMPLE_MASK 63  // time one operation in 64 per thread
 
+/*
+Free blocks are tracked in a hierarchical bitmap. Level 0 has one bit per
+block (set = free); every higher level has one bit per word of the level
+below (set = that word still has a free bit). The top level is a single
+word, so finding a free block is one count-trailing-zeros per level.
+*/
 typedef struct {
     void* memory;
-    bool* is_allocated;
+    uint64_t* levels[BITMAP_MAX_LEVELS];
+    size_t num_levels;
     size_t block_size;
     size_t num_blocks;
     size_t free_blocks;
@@ -22,6 +37,9 @@ typedef struct VariableBlock {
     struct VariableBlock* prev;
 } VariableBlock;
 
+_Static_assert(sizeof(VariableBlock) % _Alignof(max_align_t) == 0,
+               "split headers must stay aligned");
+
 
 typedef struct {
     void* memory;
@@ -39,9 +57,18 @@ typedef struct {
     void** free_lists;
     size_t min_block_size;
     size_t max_order;
+    uint64_t* split_bits;   // one bit per tree node: block was split into two buddies
+    uint64_t* free_bits;    // one bit per tree node: block is on its order's free list
 } BuddyAllocator;
 
 
+// free buddy blocks are linked through their first bytes
+typedef struct BuddyBlock {
+    struct BuddyBlock* next;
+    struct BuddyBlock* prev;
+} BuddyBlock;
+
+
 typedef struct {
     void* memory;
     size_t block_size;
@@ -57,23 +84,178 @@ typedef struct {
     size_t faild_allocations;
     size_t total_allocated;
     size_t peak_usage;
-    double fragmentation;
+    double fragmentation;       // negative when the allocator never sees requested sizes
+    size_t latency_histogram[LATENCY_BUCKETS];
 } AllocatorStats;
 
 
-FixedAllocator* initFixedAllocator() {
+/*
+Instrumentation shared by all allocators. Every thread owns a shard of
+counters per allocator kind and is the only writer of it, so recording is a
+few plain (relaxed) stores with no shared cache lines. getAllocatorStats sums
+the shards into an AllocatorStats snapshot. The one exception is bytes in
+use: a block may be freed by a different thread than the one that allocated
+it, so live bytes and their high-water mark are kept per kind in shared
+relaxed atomics, each kind on its own cache line. Latency is timed for one
+operation in LATENCY_SAMPLE_MASK + 1 to keep the clock reads off the hot path.
+*/
+typedef enum {
+    ALLOC_FIXED,
+    ALLOC_VARIABLE,
+    ALLOC_BUDDY,
+    ALLOC_POOL,
+    ALLOC_KIND_COUNT
+} AllocatorKind;
+
+
+typedef struct {
+    size_t allocations;
+    size_t deallocations;
+    size_t failed;
+    size_t requested_bytes;     // bytes callers asked for, 0 for fixed-size allocators
+    size_t granted_bytes;       // bytes actually handed out (block sizes)
+    size_t latency[LATENCY_BUCKETS];
+    uint32_t ops;
+} StatsCounters;
+
+
+typedef struct StatsShard {
+    StatsCounters kinds[ALLOC_KIND_COUNT];
+    struct StatsShard* next;
+} StatsShard;
+
+
+typedef struct {
+    int64_t live_bytes;         // granted bytes allocated minus freed, all threads
+    int64_t peak_bytes;
+} __attribute__((aligned(64))) UsageCounters;
+
+
+static UsageCounters usage[ALLOC_KIND_COUNT];
+static StatsShard* stats_shards = NULL;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread StatsShard* local_shard = NULL;
+
+#define STAT_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STAT_ADD(field, v) __atomic_store_n(&(field), (field) + (v), __ATOMIC_RELAXED)
+
+
+// this thread's counters for `kind`, registering the shard on first use
+static StatsCounters* statsCounters(AllocatorKind kind) {
+    if (local_shard == NULL) {
+        local_shard = (StatsShard*)calloc(1, sizeof(StatsShard));
+        if (local_shard == NULL) return NULL;
+
+        pthread_mutex_lock(&stats_lock);
+        local_shard->next = stats_shards;
+        stats_shards = local_shard;
+        pthread_mutex_unlock(&stats_lock);
+    }
+    return &local_shard->kinds[kind];
+}
+
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// start timestamp if this operation is sampled, 0 otherwise
+static uint64_t statsBegin(AllocatorKind kind) {
+    StatsCounters* c = statsCounters(kind);
+    if (c == NULL || (c->ops++ & LATENCY_SAMPLE_MASK) != 0) return 0;
+    return nowNs();
+}
+
+
+static void statsRecordLatency(StatsCounters* c, uint64_t start) {
+    if (start == 0) return;
+
+    uint64_t ns = nowNs() - start;
+    int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    STAT_ADD(c->latency[bucket], 1);
+}
+
+
+static void statsRecordAlloc(AllocatorKind kind, uint64_t start,
+                             size_t requested, size_t granted, bool success) {
+    StatsCounters* c = statsCounters(kind);
+    if (c == NULL) return;
+
+    if (success) {
+        STAT_ADD(c->allocations, 1);
+        STAT_ADD(c->requested_bytes, requested);
+        STAT_ADD(c->granted_bytes, granted);
+
+        UsageCounters* u = &usage[kind];
+        int64_t live = __atomic_add_fetch(&u->live_bytes, (int64_t)granted, __ATOMIC_RELAXED);
+        int64_t peak = __atomic_load_n(&u->peak_bytes, __ATOMIC_RELAXED);
+        while (live > peak && !__atomic_compare_exchange_n(&u->peak_bytes, &peak, live, true,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+    else {
+        STAT_ADD(c->failed, 1);
+    }
+    statsRecordLatency(c, start);
+}
+
+
+static void statsRecordFree(AllocatorKind kind, uint64_t start, size_t granted) {
+    StatsCounters* c = statsCounters(kind);
+    if (c == NULL) return;
+
+    STAT_ADD(c->deallocations, 1);
+    __atomic_sub_fetch(&usage[kind].live_bytes, (int64_t)granted, __ATOMIC_RELAXED);
+    statsRecordLatency(c, start);
+}
+
+
+FixedAllocator* createFixedAllocator(size_t block_size, size_t num_blocks) {
     FixedAllocator* allocator = (FixedAllocator*)malloc(sizeof(FixedAllocator));
     
-    allocator->memory = malloc(BLOCK_SIZE * NUM_BLOCKS);
-    allocator->is_allocated = (bool*)calloc(NUM_BLOCKS, sizeof(bool));
-    allocator->block_size = BLOCK_SIZE;
-    allocator->num_blocks = NUM_BLOCKS;
-    allocator->free_blocks = NUM_BLOCKS;
+    allocator->memory = malloc(block_size * num_blocks);
+    allocator->block_size = block_size;
+    allocator->num_blocks = num_blocks;
+    allocator->free_blocks = num_blocks;
+
+    // build levels bottom-up until one word covers everything
+    size_t bits = num_blocks;
+    allocator->num_levels = 0;
+    do {
+        size_t words = (bits + 63) / 64;
+        uint64_t* level = (uint64_t*)calloc(words, sizeof(uint64_t));
+
+        for (size_t w = 0; w < words; ++w) {
+            size_t valid = bits - w * 64;
+            level[w] = valid >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << valid) - 1;
+        }
+
+        allocator->levels[allocator->num_levels++] = level;
+        bits = words;
+    } while (bits > 1 && allocator->num_levels < BITMAP_MAX_LEVELS);
 
     return allocator;    
 }
 
 
+FixedAllocator* initFixedAllocator() {
+    return createFixedAllocator(BLOCK_SIZE, NUM_BLOCKS);
+}
+
+
+void destroyFixedAllocator(FixedAllocator* allocator) {
+    for (size_t level = 0; level < allocator->num_levels; ++level) {
+        free(allocator->levels[level]);
+    }
+    free(allocator->memory);
+    free(allocator);
+}
+
+
 VariableAllocator* initVariableAllocator(size_t size) {
     VariableAllocator* allocator = (VariableAllocator*)malloc(
         sizeof(VariableAllocator)
@@ -92,6 +274,12 @@ VariableAllocator* initVariableAllocator(size_t size) {
 }
 
 
+void destroyVariableAllocator(VariableAllocator* allocator) {
+    free(allocator->memory);
+    free(allocator);
+}
+
+
 BuddyAllocator* initBuddyAllocator(size_t min_block_size) {
     BuddyAllocator* allocator = (BuddyAllocator*)malloc(
         sizeof(BuddyAllocator)
@@ -106,10 +294,29 @@ BuddyAllocator* initBuddyAllocator(size_t min_block_size) {
     allocator->free_lists = (void**)calloc(MAX_ORDER + 1, sizeof(void*));
     allocator->free_lists[MAX_ORDER] = allocator->memory;
 
+    // the tree has 2^(MAX_ORDER + 1) - 1 nodes
+    size_t words = ((2UL << MAX_ORDER) + 63) / 64;
+    allocator->split_bits = (uint64_t*)calloc(words, sizeof(uint64_t));
+    allocator->free_bits = (uint64_t*)calloc(words, sizeof(uint64_t));
+
+    BuddyBlock* root = (BuddyBlock*)allocator->memory;
+    root->next = NULL;
+    root->prev = NULL;
+    allocator->free_bits[0] |= 1;   // root node (order MAX_ORDER, index 0)
+
     return allocator;
 }
 
 
+void destroyBuddyAllocator(BuddyAllocator* allocator) {
+    free(allocator->split_bits);
+    free(allocator->free_bits);
+    free(allocator->free_lists);
+    free(allocator->memory);
+    free(allocator);
+}
+
+
 MemoryPool* initMemoryPool(size_t block_size, size_t num_blocks) {
     MemoryPool* pool = (MemoryPool*)malloc(sizeof(MemoryPool));
 
@@ -128,25 +335,52 @@ MemoryPool* initMemoryPool(size_t block_size, size_t num_blocks) {
 }
 
 
+void destroyMemoryPool(MemoryPool* pool) {
+    free(pool->free_lists);
+    free(pool->memory);
+    free(pool);
+}
+
+
 void* allocateFixedBlock(FixedAllocator* allocator) {
+    uint64_t start = statsBegin(ALLOC_FIXED);
+
     if (allocator->free_blocks == 0) {
+        statsRecordAlloc(ALLOC_FIXED, start, 0, 0, false);
         return NULL;
     }
 
-    for (size_t i = 0; i < allocator->num_blocks; ++i) {
-        if (!allocator->is_allocated[i]) {
-            allocator->is_allocated[i] = true;
-            allocator->free_blocks--;
-            
-            return (char*)allocator->memory + (i * allocator->block_size);
-        }
+    // descend from the top word, following the lowest set bit at each level
+    size_t idx = 0;
+    for (size_t level = allocator->num_levels; level-- > 0; ) {
+        uint64_t word = allocator->levels[level][idx];
+        idx = idx * 64 + __builtin_ctzll(word);
     }
-    
-    return NULL;
+
+    // clear the block's bit and any summary bits whose word just emptied
+    size_t i = idx;
+    for (size_t level = 0; level < allocator->num_levels; ++level) {
+        uint64_t* word = &allocator->levels[level][i / 64];
+        *word &= ~((uint64_t)1 << (i % 64));
+        if (*word != 0) break;
+        i /= 64;
+    }
+
+    allocator->free_blocks--;
+    statsRecordAlloc(ALLOC_FIXED, start, 0, allocator->block_size, true);
+
+    return (char*)allocator->memory + (idx * allocator->block_size);
 }
 
 
 void* allocateVariableBlock(VariableAllocator* allocator, size_t size) {
+    uint64_t start = statsBegin(ALLOC_VARIABLE);
+
+    // keep every block, and so the header a split puts after it, aligned
+    const size_t align = _Alignof(max_align_t);
+    size_t requested = size;
+    size = (size + align - 1) & ~(align - 1);
+
     VariableBlock* curr = allocator->free_list;
     VariableBlock* best_fit = NULL;
     size_t min_diff = allocator->total_size;
@@ -164,6 +398,7 @@ void* allocateVariableBlock(VariableAllocator* allocator, size_t size) {
     }
 
     if (best_fit == NULL) {
+        statsRecordAlloc(ALLOC_VARIABLE, start, requested, 0, false);
         return NULL;
     }
 
@@ -186,6 +421,7 @@ void* allocateVariableBlock(VariableAllocator* allocator, size_t size) {
     }
 
     best_fit->is_allocated = true;
+    statsRecordAlloc(ALLOC_VARIABLE, start, requested, best_fit->size, true);
     
     return (char*)best_fit + sizeof(VariableBlock);
 }
@@ -194,12 +430,231 @@ void* allocateVariableBlock(VariableAllocator* allocator, size_t size) {
 void freeFixedBlock(FixedAllocator* allocator, void* ptr) {
     if (ptr == NULL) return;
 
+    uint64_t start = statsBegin(ALLOC_FIXED);
+
     size_t idx = ((char*)ptr - (char*)allocator->memory) / allocator->block_size;
 
-    if (idx < allocator->num_blocks && allocator->is_allocated[idx]) {
-        allocator->is_allocated[idx] = false;
-        allocator->free_blocks++;
+    if (idx >= allocator->num_blocks ||
+        (allocator->levels[0][idx / 64] >> (idx % 64)) & 1) {
+        return;     // out of range or already free
+    }
+
+    // set the block's bit and any summary bits whose word was empty
+    for (size_t level = 0; level < allocator->num_levels; ++level) {
+        uint64_t* word = &allocator->levels[level][idx / 64];
+        bool was_empty = (*word == 0);
+        *word |= (uint64_t)1 << (idx % 64);
+        if (!was_empty) break;
+        idx /= 64;
+    }
+
+    allocator->free_blocks++;
+    statsRecordFree(ALLOC_FIXED, start, allocator->block_size);
+}
+
+
+void freeVariableBlock(VariableAllocator* allocator, void* ptr) {
+    if (ptr == NULL) return;
+
+    uint64_t start = statsBegin(ALLOC_VARIABLE);
+
+    VariableBlock* block = (VariableBlock*)((char*)ptr - sizeof(VariableBlock));
+    size_t granted = block->size;
+    block->is_allocated = false;
+
+    // the block list is in address order, so list neighbours are physical neighbours
+    if (block->next && !block->next->is_allocated) {
+        block->size += sizeof(VariableBlock) + block->next->size;
+        block->next = block->next->next;
+        if (block->next) {
+            block->next->prev = block;
+        }
+    }
+
+    if (block->prev && !block->prev->is_allocated) {
+        block->prev->size += sizeof(VariableBlock) + block->size;
+        block->prev->next = block->next;
+        if (block->next) {
+            block->next->prev = block->prev;
+        }
+    }
+
+    (void)allocator;
+    statsRecordFree(ALLOC_VARIABLE, start, granted);
+}
+
+
+/*
+Buddy bookkeeping: blocks form a complete binary tree with the whole arena at
+the root (order max_order) and min_block_size blocks at the leaves (order 0).
+Node (order, index) lives at bit (2^(max_order - order) - 1 + index) of the
+split and free bitmaps, so a block's buddy is index ^ 1 and its parent is
+index >> 1. Checking whether a buddy can be merged is one bit test, and both
+allocate and free touch at most max_order + 1 levels.
+*/
+static size_t buddyNode(BuddyAllocator* allocator, size_t order, size_t index) {
+    return ((size_t)1 << (allocator->max_order - order)) - 1 + index;
+}
+
+
+static bool testBit(uint64_t* bits, size_t node) {
+    return (bits[node / 64] >> (node % 64)) & 1;
+}
+
+
+static void setBit(uint64_t* bits, size_t node) {
+    bits[node / 64] |= (uint64_t)1 << (node % 64);
+}
+
+
+static void clearBit(uint64_t* bits, size_t node) {
+    bits[node / 64] &= ~((uint64_t)1 << (node % 64));
+}
+
+
+static size_t buddyIndex(BuddyAllocator* allocator, void* block, size_t order) {
+    size_t offset = (char*)block - (char*)allocator->memory;
+    return offset / (allocator->min_block_size << order);
+}
+
+
+static void buddyPush(BuddyAllocator* allocator, void* ptr, size_t order) {
+    BuddyBlock* block = (BuddyBlock*)ptr;
+    BuddyBlock* head = (BuddyBlock*)allocator->free_lists[order];
+
+    block->prev = NULL;
+    block->next = head;
+    if (head) {
+        head->prev = block;
+    }
+    allocator->free_lists[order] = block;
+
+    setBit(allocator->free_bits, buddyNode(allocator, order, buddyIndex(allocator, ptr, order)));
+}
+
+
+static void buddyRemove(BuddyAllocator* allocator, void* ptr, size_t order) {
+    BuddyBlock* block = (BuddyBlock*)ptr;
+
+    if (block->prev) {
+        block->prev->next = block->next;
+    }
+    else {
+        allocator->free_lists[order] = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    clearBit(allocator->free_bits, buddyNode(allocator, order, buddyIndex(allocator, ptr, order)));
+}
+
+
+// smallest order whose block holds `size` bytes
+static size_t buddyOrder(BuddyAllocator* allocator, size_t size) {
+    size_t order = 0;
+    while ((allocator->min_block_size << order) < size) {
+        order++;
     }
+    return order;
+}
+
+
+void* allocateBuddyBlock(BuddyAllocator* allocator, size_t size) {
+    uint64_t start = statsBegin(ALLOC_BUDDY);
+
+    if (size == 0 || size > (allocator->min_block_size << allocator->max_order)) {
+        statsRecordAlloc(ALLOC_BUDDY, start, size, 0, false);
+        return NULL;
+    }
+
+    size_t order = buddyOrder(allocator, size);
+
+    // smallest non-empty order that can satisfy the request
+    size_t curr = order;
+    while (curr <= allocator->max_order && allocator->free_lists[curr] == NULL) {
+        curr++;
+    }
+    if (curr > allocator->max_order) {
+        statsRecordAlloc(ALLOC_BUDDY, start, size, 0, false);
+        return NULL;
+    }
+
+    void* block = allocator->free_lists[curr];
+    buddyRemove(allocator, block, curr);
+
+    // split down to the requested order, keeping the lower half each time
+    while (curr > order) {
+        setBit(allocator->split_bits,
+               buddyNode(allocator, curr, buddyIndex(allocator, block, curr)));
+        curr--;
+        buddyPush(allocator, (char*)block + (allocator->min_block_size << curr), curr);
+    }
+
+    statsRecordAlloc(ALLOC_BUDDY, start, size, allocator->min_block_size << order, true);
+    return block;
+}
+
+
+void freeBuddyBlock(BuddyAllocator* allocator, void* ptr) {
+    if (ptr == NULL) return;
+
+    uint64_t start = statsBegin(ALLOC_BUDDY);
+
+    // the block's order is the first unsplit node on the path from the root
+    size_t order = allocator->max_order;
+    while (order > 0 &&
+           testBit(allocator->split_bits,
+                   buddyNode(allocator, order, buddyIndex(allocator, ptr, order)))) {
+        order--;
+    }
+
+    size_t index = buddyIndex(allocator, ptr, order);
+    size_t granted = allocator->min_block_size << order;
+
+    // merge upwards while the buddy is free as a whole
+    while (order < allocator->max_order &&
+           testBit(allocator->free_bits, buddyNode(allocator, order, index ^ 1))) {
+        void* buddy = (char*)allocator->memory +
+                      (index ^ 1) * (allocator->min_block_size << order);
+        buddyRemove(allocator, buddy, order);
+
+        index >>= 1;
+        order++;
+        clearBit(allocator->split_bits, buddyNode(allocator, order, index));
+    }
+
+    buddyPush(allocator,
+              (char*)allocator->memory + index * (allocator->min_block_size << order),
+              order);
+
+    statsRecordFree(ALLOC_BUDDY, start, granted);
+}
+
+
+// the pool keeps its free blocks as a stack of pointers
+void* allocatePoolBlock(MemoryPool* pool) {
+    uint64_t start = statsBegin(ALLOC_POOL);
+
+    if (pool->free_blocks == 0) {
+        statsRecordAlloc(ALLOC_POOL, start, 0, 0, false);
+        return NULL;
+    }
+
+    void* block = pool->free_lists[--pool->free_blocks];
+    statsRecordAlloc(ALLOC_POOL, start, 0, pool->block_size, true);
+
+    return block;
+}
+
+
+void freePoolBlock(MemoryPool* pool, void* ptr) {
+    if (ptr == NULL || pool->free_blocks == pool->num_blocks) return;
+
+    uint64_t start = statsBegin(ALLOC_POOL);
+
+    pool->free_lists[pool->free_blocks++] = ptr;
+    statsRecordFree(ALLOC_POOL, start, pool->block_size);
 }
 
 
@@ -218,6 +673,213 @@ void updateStats(AllocatorStats* stats, size_t size, bool success) {
 }
 
 
+// sum every thread's counters for one allocator kind into a snapshot.
+// peak_usage is the high-water mark of bytes in use across all threads.
+// fragmentation is internal: the share of granted bytes nobody asked for.
+// Fixed and pool allocations take no size, so theirs is left unreported.
+AllocatorStats getAllocatorStats(AllocatorKind kind) {
+    AllocatorStats stats = {0};
+    size_t requested = 0, granted = 0;
+
+    pthread_mutex_lock(&stats_lock);
+    for (StatsShard* shard = stats_shards; shard; shard = shard->next) {
+        StatsCounters* c = &shard->kinds[kind];
+
+        stats.allocations += STAT_LOAD(c->allocations);
+        stats.deallocations += STAT_LOAD(c->deallocations);
+        stats.faild_allocations += STAT_LOAD(c->failed);
+        requested += STAT_LOAD(c->requested_bytes);
+        granted += STAT_LOAD(c->granted_bytes);
+
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+            stats.latency_histogram[b] += STAT_LOAD(c->latency[b]);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    int64_t live = __atomic_load_n(&usage[kind].live_bytes, __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&usage[kind].peak_bytes, __ATOMIC_RELAXED);
+    stats.total_allocated = live > 0 ? (size_t)live : 0;
+    stats.peak_usage = peak > 0 ? (size_t)peak : 0;
+    stats.fragmentation = requested ? 1.0 - (double)requested / granted : -1.0;
+
+    return stats;
+}
+
+
+void printAllocatorStats(AllocatorKind kind) {
+    static const char* names[] = { "Fixed", "Variable", "Buddy", "Pool" };
+    AllocatorStats stats = getAllocatorStats(kind);
+
+    printf("\n%s allocator stats:\n", names[kind]);
+    printf("  allocations: %zu, deallocations: %zu, failed: %zu\n",
+           stats.allocations, stats.deallocations, stats.faild_allocations);
+    printf("  in use: %zu bytes, peak: %zu bytes, internal fragmentation: ",
+           stats.total_allocated, stats.peak_usage);
+    if (stats.fragmentation < 0) printf("n/a (caller sizes unknown)\n");
+    else printf("%.1f%%\n", stats.fragmentation * 100);
+    printf("  sampled latency:");
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+        if (stats.latency_histogram[b]) {
+            printf(" <%lluns:%zu", 1ULL << b, stats.latency_histogram[b]);
+        }
+    }
+    printf("\n");
+}
+
+
+// ---------------------------------------------------------------------------
+// Mixed-size trace benchmark: throughput and internal fragmentation
+// ---------------------------------------------------------------------------
+
+#define TRACE_OPS 200000
+#define TRACE_LIVE 48           // live allocations kept by the trace
+#define TRACE_MIN_SIZE 16
+#define TRACE_MAX_SIZE BLOCK_SIZE
+
+typedef struct {
+    const char* name;
+    double ops_per_sec;
+    size_t failed;
+    double internal_fragmentation;  // unused bytes inside granted blocks / granted bytes
+} TraceResult;
+
+
+typedef enum { TRACE_FIXED, TRACE_VARIABLE, TRACE_BUDDY } TraceTarget;
+
+
+static TraceResult runTrace(TraceTarget target) {
+    FixedAllocator* fixed = NULL;
+    VariableAllocator* variable = NULL;
+    BuddyAllocator* buddy = NULL;
+
+    switch (target) {
+    case TRACE_FIXED:    fixed = initFixedAllocator(); break;
+    case TRACE_VARIABLE: variable = initVariableAllocator(32 << MAX_ORDER); break;
+    case TRACE_BUDDY:    buddy = initBuddyAllocator(32); break;
+    }
+
+    void* live[TRACE_LIVE] = {0};
+    unsigned int seed = 42;
+    size_t requested = 0, granted = 0, failed = 0;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < TRACE_OPS; ++i) {
+        int slot = rand_r(&seed) % TRACE_LIVE;
+        size_t size = TRACE_MIN_SIZE + rand_r(&seed) % (TRACE_MAX_SIZE - TRACE_MIN_SIZE + 1);
+
+        if (live[slot]) {
+            switch (target) {
+            case TRACE_FIXED:    freeFixedBlock(fixed, live[slot]); break;
+            case TRACE_VARIABLE: freeVariableBlock(variable, live[slot]); break;
+            case TRACE_BUDDY:    freeBuddyBlock(buddy, live[slot]); break;
+            }
+        }
+
+        size_t block_bytes = 0;
+        switch (target) {
+        case TRACE_FIXED:
+            live[slot] = allocateFixedBlock(fixed);
+            block_bytes = fixed->block_size;
+            break;
+        case TRACE_VARIABLE:
+            live[slot] = allocateVariableBlock(variable, size);
+            if (live[slot]) {
+                VariableBlock* header = (VariableBlock*)((char*)live[slot] - sizeof(VariableBlock));
+                block_bytes = header->size;
+            }
+            break;
+        case TRACE_BUDDY:
+            live[slot] = allocateBuddyBlock(buddy, size);
+            block_bytes = buddy->min_block_size << buddyOrder(buddy, size);
+            break;
+        }
+
+        if (live[slot]) {
+            requested += size;
+            granted += block_bytes;
+        }
+        else {
+            failed++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // live blocks go down with their arenas
+    switch (target) {
+    case TRACE_FIXED:    destroyFixedAllocator(fixed); break;
+    case TRACE_VARIABLE: destroyVariableAllocator(variable); break;
+    case TRACE_BUDDY:    destroyBuddyAllocator(buddy); break;
+    }
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    static const char* names[] = { "Fixed", "Variable", "Buddy" };
+    TraceResult result = {
+        names[target],
+        TRACE_OPS / secs,
+        failed,
+        granted ? 1.0 - (double)requested / granted : 0.0
+    };
+    return result;
+}
+
+
+void benchmarkAllocators() {
+    printf("Mixed-size trace (%d ops, %d-%d bytes, %d live):\n",
+           TRACE_OPS, TRACE_MIN_SIZE, TRACE_MAX_SIZE, TRACE_LIVE);
+    printf("%-10s %-14s %-8s %s\n", "Allocator", "ops/sec", "failed", "internal frag");
+
+    for (int t = TRACE_FIXED; t <= TRACE_BUDDY; ++t) {
+        TraceResult r = runTrace((TraceTarget)t);
+        printf("%-10s %-14.0f %-8zu %.1f%%\n",
+               r.name, r.ops_per_sec, r.failed, r.internal_fragmentation * 100);
+    }
+}
+
+
+// allocation cost as a large fixed allocator fills up
+void benchmarkFixedBitmap() {
+    size_t num_blocks = (size_t)1 << 21;
+    FixedAllocator* allocator = createFixedAllocator(16, num_blocks);
+    size_t tenth = num_blocks / 10;
+    struct timespec start, end;
+
+    printf("\nFixed allocator with %zu blocks (ns per allocation):\n", num_blocks);
+    for (int decile = 0; decile < 10; ++decile) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < tenth; ++i) {
+            allocateFixedBlock(allocator);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        printf("%3d%%-%3d%% full: %.1f\n", decile * 10, decile * 10 + 10, ns / tenth);
+    }
+
+    destroyFixedAllocator(allocator);
+}
+
+
 int main() {
+    benchmarkAllocators();
+    benchmarkFixedBitmap();
+
+    MemoryPool* pool = initMemoryPool(64, NUM_BLOCKS);
+    void* blocks[NUM_BLOCKS];
+    for (int round = 0; round < 1000; ++round) {
+        for (int i = 0; i < NUM_BLOCKS; ++i) {
+            blocks[i] = allocatePoolBlock(pool);
+        }
+        for (int i = 0; i < NUM_BLOCKS; ++i) {
+            freePoolBlock(pool, blocks[i]);
+        }
+    }
+    destroyMemoryPool(pool);
+
+    for (int kind = 0; kind < ALLOC_KIND_COUNT; ++kind) {
+        printAllocatorStats((AllocatorKind)kind);
+    }
+
     return 0;
 }
@@ -4,11 +4,40 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <unistd.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <math.h>
 
-#define ALIGNMENT 8
 #define ALIGN(size) (((size) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
-#define BLOCK_SIZE sizeof(block_t)
-#define MAX_ALLOC 1000
+#define BLOCK_SIZE offsetof(block_t, data)     // header size, data starts right after it
+#define FOOTER_SIZE sizeof(size_t)              // boundary tag: copy of the size at the end of every block
+#define REQUEST_SIZE(size) ALIGN((size) + BLOCK_SIZE + FOOTER_SIZE)
+#define PROLOGUE_SIZE ALIGN(BLOCK_SIZE + FOOTER_SIZE)  // in-use fence at the start of each sbrk region
+#define EPILOGUE_SIZE ALIGN(BLOCK_SIZE)                // size-0 in-use header ending each region
+
+// Allocation tracking: open-addressing table of sampled allocations
+#define TRACK_INITIAL_CAPACITY 1024  // power of two
+#define TRACK_MAX_LOAD 0.7           // live + deleted slots before the table grows
+#define DEFAULT_SAMPLE_RATE (512 * 1024)  // mean bytes between samples; 0 tracks everything
+
+// Size-class bins: power-of-two block sizes from 64 to 2048 bytes (header included)
+#define MIN_CLASS_SHIFT 6
+#define NUM_SIZE_CLASSES 6
+#define MAX_CLASS_SIZE ((size_t)1 << (MIN_CLASS_SHIFT + NUM_SIZE_CLASSES - 1))
+#define BIN_REFILL_COUNT 16     // blocks carved from the heap per empty-bin refill
+
+// Large allocations and heap trimming
+#define MMAP_THRESHOLD (128 * 1024)  // requests at or above this get their own anonymous mapping
+#define TRIM_THRESHOLD (256 * 1024)  // free top-of-heap size that triggers an automatic trim
+#define TOP_PAD (64 * 1024)          // free bytes left at the top after an automatic trim
+#define MMAPPED_BIT ((size_t)1)      // set in block->size of mmap-backed blocks (sizes are aligned)
+
+// Per-thread caches in front of the shared heap
+#define TCACHE_BATCH 32         // blocks moved between a thread cache and the central bins at once
+#define TCACHE_MAX 64           // cached blocks per class before a batch is flushed back
 
 
 // Optimize memory alignment for different architectures
@@ -19,10 +48,6 @@
 #endif
 
 
-static allocation_info_t allocations[MAX_ALLOC];
-static int alloc_cnt = 0;
-
-
 typedef struct block_t {
     bool is_free;           // whether block is free
     size_t size;            // size of block including header               
@@ -43,11 +68,23 @@ typedef struct block_t {
 // } __attribute__((aligned(ALIGNMENT))) block_t;
 
 
+typedef enum {
+    ALLOC_MODE_BEST_FIT,    // walk the whole free list for every request
+    ALLOC_MODE_SIZE_CLASS   // small requests are served from per-class bins in O(1)
+} alloc_mode_t;
+
+
 typedef struct {
     block_t* free_list;
     block_t* used_list;
     size_t total_size;
     size_t used_size;
+    alloc_mode_t mode;
+    block_t* bins[NUM_SIZE_CLASSES];    // singly linked through block->next
+    size_t bin_count[NUM_SIZE_CLASSES];
+    block_t* epilogue;                  // end fence of the most recent sbrk region
+    size_t mmap_size;                   // bytes held by mmap-backed blocks
+    size_t mmap_count;
 } heap_t;
 
 
@@ -56,34 +93,125 @@ typedef struct {
     size_t size;
     const char* file;
     int line;
+    double weight;      // allocations this sample stands for (1 / sampling probability)
 } allocation_info_t;
 
 
+// a slot is empty (ptr == NULL), deleted (ptr == TRACK_DELETED) or live
+typedef struct {
+    allocation_info_t* slots;
+    size_t capacity;
+    size_t live;
+    size_t deleted;
+} alloc_table_t;
+
+#define TRACK_DELETED ((void*)1)
+
+
 // global heap structure
 static heap_t heap = {0};
 
+static alloc_table_t tracked = {0};
+static size_t sample_rate = DEFAULT_SAMPLE_RATE;
+static long long bytes_until_sample = 0;
+
+static void set_footer(block_t* block) {
+    *(size_t*)((char*)block + block->size - FOOTER_SIZE) = block->size;
+}
+
+
+static block_t* next_physical(block_t* block) {
+    return (block_t*)((char*)block + block->size);
+}
+
+
+// the footer right before a block holds the size of its physical predecessor
+static block_t* prev_physical(block_t* block) {
+    size_t prev_size = *(size_t*)((char*)block - FOOTER_SIZE);
+    return (block_t*)((char*)block - prev_size);
+}
+
+
+static void unlink_free(block_t* block) {
+    if (block->prev) {
+        block->prev->next = block->next;
+    }
+    else {
+        heap.free_list = block->next;
+    }
+
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+}
+
+
+static void push_free(block_t* block) {
+    block->is_free = true;
+    block->next = heap.free_list;
+    block->prev = NULL;
+    if (heap.free_list) {
+        heap.free_list->prev = block;
+    }
+    heap.free_list = block;
+}
+
+
+block_t* coalesce_blocks(block_t* block);
+
+
+// add `size` usable bytes to the heap as a free block and return it (merged
+// with a free tail, if any). a region that continues right after our last
+// epilogue reuses it as the new block header; otherwise the region gets its
+// own prologue/epilogue fences so neighbour lookups never leave it.
+static block_t* extend_heap(size_t size) {
+    char* brk = (char*)sbrk(0);
+    block_t* block;
+
+    if (heap.epilogue && brk == (char*)heap.epilogue + EPILOGUE_SIZE) {
+        if (sbrk(size) == (void*)-1) return NULL;
+        block = heap.epilogue;
+    }
+    else {
+        size_t pad = ALIGN((uintptr_t)brk) - (uintptr_t)brk;
+        if (sbrk(pad + PROLOGUE_SIZE + size + EPILOGUE_SIZE) == (void*)-1) return NULL;
+
+        block_t* prologue = (block_t*)(brk + pad);
+        prologue->size = PROLOGUE_SIZE;
+        prologue->is_free = false;
+        set_footer(prologue);
+
+        block = next_physical(prologue);
+    }
+
+    block->size = size;
+    set_footer(block);
+    push_free(block);
+
+    heap.epilogue = next_physical(block);
+    heap.epilogue->size = 0;
+    heap.epilogue->is_free = false;
+
+    heap.total_size += size;
+
+    return coalesce_blocks(block);
+}
+
+
 void init_heap(size_t ini_size) {
     ini_size = ALIGN(ini_size);
 
+    // initialize heap
+    heap.free_list = NULL;
+    heap.used_list = NULL;
+    heap.total_size = 0;
+    heap.used_size = 0;
+
     // request memory from OS
-    void* memory = sbrk(ini_size);
-    if (memory == (void*) - 1) {
+    if (extend_heap(ini_size) == NULL) {
         perror("Failed to initialize heap");
         return;
     }
-
-    // initialize first block
-    block_t* ini_block = (block_t*)memory;
-    ini_block->size = ini_size;
-    ini_block->is_free = true;
-    ini_block->next = NULL;
-    ini_block->prev = NULL;
-
-    // initialize heap
-    heap.free_list = ini_block;
-    heap.used_size = NULL;
-    heap.total_size = ini_size;
-    heap.used_size = 0;
 }
 
 
@@ -101,7 +229,7 @@ block_t* find_best_fit(size_t size) {
                 best = curr;
 
                 // if perfect fit, stop
-                if (diff = 0) break;
+                if (diff == 0) break;
             }
         }
         curr = curr->next;
@@ -115,12 +243,13 @@ void split_block(block_t* block, size_t size) {
     size_t remaining_size = block->size - size;
 
     // only split if remaining size is large enough for a new block
-    if (remaining_size > BLOCK_SIZE + ALIGNMENT) {
+    if (remaining_size > BLOCK_SIZE + FOOTER_SIZE + ALIGNMENT) {
         block_t* new_block = (block_t*)((char*)block + size);
         new_block->size = remaining_size;
         new_block->is_free = true;
         new_block->next = block->next;
         new_block->prev = block;
+        set_footer(new_block);
 
         if (block->next) {
             block->next->prev = new_block;
@@ -128,39 +257,24 @@ void split_block(block_t* block, size_t size) {
 
         block->next = new_block;
         block->size = size;
+        set_footer(block);
     }
 }
 
 
-void* custom_malloc(size_t size) {
-    if (size == 0) return NULL;
-
-    // adjust size to include header and alignment
-    size_t total_size = ALIGN(size + BLOCK_SIZE);
-
+// take a block of at least total_size bytes off the free list, growing the heap if needed.
+// the block is marked in use but not linked into the used list.
+static block_t* take_free_block(size_t total_size) {
     // find suitable block
     block_t* block = find_best_fit(total_size);
 
     // if no suitable block found, request more memory
     if (block == NULL) {
         size_t request_size = total_size > 4096 ? total_size : 4096;
-        void* memory = sbrk(request_size);
-        if (memory == (void*)-1) {  // fail
+        block = extend_heap(request_size);
+        if (block == NULL) {  // fail
             return NULL;
         }
-
-        block = (block_t*)memory;
-        block->size = request_size;
-        block->is_free = true;
-        block->next = heap.free_list;
-        block->prev = NULL;
-
-        if (heap.free_list) {
-            heap.free_list->prev = block;
-        }
-
-        heap.free_list = block;
-        heap.total_size += request_size;
     }
 
     // split block if necessary
@@ -169,52 +283,275 @@ void* custom_malloc(size_t size) {
     // mark block as used
     block->is_free = false;
 
-    // remove from free-list and add to used-list
+    // remove from free-list
+    unlink_free(block);
+
+    block->next = NULL;
+    block->prev = NULL;
+
+    return block;
+}
+
+
+static void push_used(block_t* block) {
+    block->next = heap.used_list;
+    block->prev = NULL;
+
+    if (heap.used_list) {
+        heap.used_list->prev = block;
+    }
+
+    heap.used_list = block;
+    heap.used_size += block->size;
+}
+
+
+static void remove_used(block_t* block) {
     if (block->prev) {
         block->prev->next = block->next;
     }
     else {
-        heap.free_list = block->next;
+        heap.used_list = block->next;
     }
 
     if (block->next) {
         block->next->prev = block->prev;
     }
 
-    block->next = heap.used_list;
+    heap.used_size -= block->size;
+}
+
+
+// map a total block size to its bin, or -1 if it is not a small request
+static int size_class_index(size_t total_size) {
+    if (total_size > MAX_CLASS_SIZE) return -1;
+
+    int idx = 0;
+    size_t class_size = (size_t)1 << MIN_CLASS_SHIFT;
+    while (class_size < total_size) {
+        class_size <<= 1;
+        idx++;
+    }
+
+    return idx;
+}
+
+
+static size_t class_size_of(int idx) {
+    return (size_t)1 << (MIN_CLASS_SHIFT + idx);
+}
+
+
+static void release_to_free_list(block_t* block);
+
+
+// carve BIN_REFILL_COUNT blocks of one class out of a single heap block.
+// binned blocks keep is_free == false: to the general heap they look allocated,
+// so they are never coalesced while they sit in a bin.
+// every binned block is exactly class_size bytes.
+static bool refill_bin(int idx) {
+    size_t class_size = class_size_of(idx);
+    block_t* chunk = take_free_block(class_size * BIN_REFILL_COUNT);
+    if (chunk == NULL) {
+        // fall back to a single block when a whole batch does not fit
+        chunk = take_free_block(class_size);
+        if (chunk == NULL) return false;
+    }
+
+    // split_block may leave a small tail attached; the last block keeps it
+    // and goes back to the free list instead of the bin
+    size_t count = chunk->size / class_size;
+    size_t tail = chunk->size - count * class_size;
+    size_t binned = tail ? count - 1 : count;
+
+    char* base = (char*)chunk;
+    for (size_t i = 0; i < binned; ++i) {
+        block_t* block = (block_t*)(base + i * class_size);
+        block->size = class_size;
+        block->is_free = false;
+        block->prev = NULL;
+        set_footer(block);
+        block->next = heap.bins[idx];
+        heap.bins[idx] = block;
+        heap.bin_count[idx]++;
+    }
+    if (tail) {
+        block_t* last = (block_t*)(base + binned * class_size);
+        last->size = class_size + tail;
+        set_footer(last);
+        release_to_free_list(last);
+    }
+
+    return binned > 0;
+}
+
+
+// mmap-backed blocks live outside the heap: they are not on any list and
+// are tracked only through heap.mmap_size / heap.mmap_count
+static void* mmap_alloc(size_t total_size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (total_size + page - 1) & ~(page - 1);
+
+    void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+
+    block_t* block = (block_t*)memory;
+    block->size = length | MMAPPED_BIT;
+    block->is_free = false;
+    block->next = NULL;
     block->prev = NULL;
 
-    if (heap.used_list) {
-        heap.used_list->prev = block;
+    heap.mmap_size += length;
+    heap.mmap_count++;
+
+    return block->data;
+}
+
+
+static void mmap_free(block_t* block) {
+    size_t length = block->size & ~MMAPPED_BIT;
+
+    heap.mmap_size -= length;
+    heap.mmap_count--;
+
+    munmap(block, length);
+}
+
+
+void* custom_malloc(size_t size) {
+    if (size == 0) return NULL;
+
+    // adjust size to include header and alignment
+    size_t total_size = REQUEST_SIZE(size);
+
+    // large requests bypass the heap so their memory goes straight back on free
+    if (total_size >= MMAP_THRESHOLD) {
+        return mmap_alloc(total_size);
     }
 
-    heap.used_list = block;
-    heap.used_size += block->size;
+    block_t* block = NULL;
+    int idx = heap.mode == ALLOC_MODE_SIZE_CLASS ? size_class_index(total_size) : -1;
+
+    if (idx >= 0) {
+        // O(1) pop from the class bin
+        if (heap.bins[idx] == NULL && !refill_bin(idx)) {
+            return NULL;
+        }
+
+        block = heap.bins[idx];
+        heap.bins[idx] = block->next;
+        heap.bin_count[idx]--;
+    }
+    else {
+        block = take_free_block(total_size);
+        if (block == NULL) return NULL;
+    }
+
+    // add to used-list
+    push_used(block);
 
     return block->data;
 }
 
 
-// coalesce adjacent free blocks
-void coalesce_blocks(block_t* block) {
+// coalesce a free block with its physical neighbours in O(1) using the
+// boundary tags, and return the merged block.
+// the region fences are never free, so this never walks off a region.
+block_t* coalesce_blocks(block_t* block) {
     // coalesce with next block
-    if (block->next && block->next->is_free) {
-        block->size += block->next->size;
-        block->next = block->next->next;
-        if (block->next) {
-            block->next->prev = block;
-        }
+    block_t* next = next_physical(block);
+    if (next->is_free) {
+        unlink_free(next);
+        block->size += next->size;
+        set_footer(block);
+    }
 
-        // coalesce with previous block
-        if (block->prev && block->prev->is_free) {
-            block->prev->size += block->size;
-            block->prev->next = block->next;
-            if (block->next) {
-                block->next->prev = block->prev;
-            }
-            block = block->prev;
+    // coalesce with previous block
+    block_t* prev = prev_physical(block);
+    if (prev->is_free) {
+        unlink_free(block);
+        prev->size += block->size;
+        set_footer(prev);
+        block = prev;
+    }
+
+    return block;
+}
+
+
+// shrink the most recent region when its last block is free, keeping at
+// least `pad` bytes. only possible while nothing else (e.g. the libc
+// malloc) has moved the break past our epilogue.
+static int trim_top(size_t pad) {
+    if (heap.epilogue == NULL || sbrk(0) != (char*)heap.epilogue + EPILOGUE_SIZE) {
+        return 0;
+    }
+
+    block_t* top = prev_physical(heap.epilogue);
+    if (!top->is_free) return 0;
+
+    size_t keep = ALIGN(pad);
+    if (keep < BLOCK_SIZE + FOOTER_SIZE) {
+        keep = ALIGN(BLOCK_SIZE + FOOTER_SIZE);
+    }
+    if (top->size <= keep) return 0;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t release = (top->size - keep) & ~(page - 1);
+    if (release == 0) return 0;
+
+    if (sbrk(-(intptr_t)release) == (void*)-1) {
+        return 0;
+    }
+
+    top->size -= release;
+    set_footer(top);
+
+    heap.epilogue = next_physical(top);
+    heap.epilogue->size = 0;
+    heap.epilogue->is_free = false;
+
+    heap.total_size -= release;
+
+    return 1;
+}
+
+
+// give unused heap memory back to the OS, like malloc_trim(3): shrink the
+// top of the heap, then drop the whole pages inside every other free block
+// with MADV_DONTNEED (the header and footer pages stay resident).
+// returns 1 if any memory was released.
+int custom_malloc_trim(size_t pad) {
+    int released = trim_top(pad);
+
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    for (block_t* curr = heap.free_list; curr; curr = curr->next) {
+        uintptr_t start = ((uintptr_t)curr + BLOCK_SIZE + page - 1) & ~(page - 1);
+        uintptr_t end = ((uintptr_t)curr + curr->size - FOOTER_SIZE) & ~(page - 1);
+
+        if (end > start && madvise((void*)start, end - start, MADV_DONTNEED) == 0) {
+            released = 1;
         }
     }
+
+    return released;
+}
+
+
+// return a block to the general free list and merge it with its neighbours
+static void release_to_free_list(block_t* block) {
+    push_free(block);
+
+    // coalesce adjacent free blocks
+    block = coalesce_blocks(block);
+
+    // shrink the heap once a large free tail has built up
+    if (block->size >= TRIM_THRESHOLD && next_physical(block) == heap.epilogue) {
+        trim_top(TOP_PAD);
+    }
 }
 
 
@@ -224,32 +561,65 @@ void custom_free(void* ptr) {
     // get block header
     block_t* block = (block_t*)((char*)ptr - BLOCK_SIZE);
 
-    // mark block as free
-    block->is_free = true;
+    if (block->size & MMAPPED_BIT) {
+        mmap_free(block);
+        return;
+    }
 
     // remove from used-list
-    if (block->prev) {
-        block->prev->next = block->next;
-    }
-    else {
-        heap.used_list = block->next;
+    remove_used(block);
+
+    // blocks of an exact class size go back to their bin in O(1)
+    int idx = heap.mode == ALLOC_MODE_SIZE_CLASS ? size_class_index(block->size) : -1;
+    if (idx >= 0 && class_size_of(idx) == block->size) {
+        block->prev = NULL;
+        block->next = heap.bins[idx];
+        heap.bins[idx] = block;
+        heap.bin_count[idx]++;
+        return;
     }
 
-    if (block->next) {
-        block->next->prev = block->prev;
+    release_to_free_list(block);
+}
+
+
+// hand every binned block back to the general free list
+void flush_bins() {
+    for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+        while (heap.bins[i]) {
+            block_t* block = heap.bins[i];
+            heap.bins[i] = block->next;
+            release_to_free_list(block);
+        }
+        heap.bin_count[i] = 0;
     }
+}
 
-    block->next = heap.free_list;
-    block->prev = NULL;
-    if (heap.free_list) {
-        heap.free_list->prev = block;
+
+void set_allocator_mode(alloc_mode_t mode) {
+    if (heap.mode == ALLOC_MODE_SIZE_CLASS && mode != ALLOC_MODE_SIZE_CLASS) {
+        flush_bins();
     }
-    heap.free_list = block;
+    heap.mode = mode;
+}
 
-    heap.used_size -= block->size;
 
-    // coalesce adjacent free blocks
-    coalesce_blocks(block);
+// external fragmentation: share of free-list memory that lies outside the
+// largest free block. 0 means all free memory is one block; close to 1 means
+// it is scattered in pieces too small for large requests.
+double external_fragmentation() {
+    size_t total_free = 0;
+    size_t largest_free = 0;
+
+    for (block_t* curr = heap.free_list; curr; curr = curr->next) {
+        total_free += curr->size;
+        if (curr->size > largest_free) {
+            largest_free = curr->size;
+        }
+    }
+
+    if (total_free == 0) return 0.0;
+    return 1.0 - (double)largest_free / total_free;
 }
 
 
@@ -258,6 +628,8 @@ void print_memory_stats() {
     printf("Total Heap Size: %zu bytes\n", heap.total_size);
     printf("Used Size: %zu bytes\n", heap.used_size);
     printf("Free Size: %zu bytes\n", heap.total_size - heap.used_size);
+    printf("External Fragmentation: %.2f%%\n", external_fragmentation() * 100);
+    printf("Mmapped: %zu blocks, %zu bytes\n", heap.mmap_count, heap.mmap_size);
     
     printf("\nFree Blocks:\n");
 
@@ -274,17 +646,125 @@ void print_memory_stats() {
         printf("Block at %p, size: %zu\n", (void*)curr, curr->size);
         curr = curr->next;
     }
+
+    if (heap.mode == ALLOC_MODE_SIZE_CLASS) {
+        printf("Size-Class Bins (counted as free):\n");
+        for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+            printf("Class %zu bytes: %zu cached blocks\n",
+                    class_size_of(i), heap.bin_count[i]);
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Allocation tracking
+//
+// Instead of recording every allocation, debug_malloc samples on average one
+// allocation per `sample_rate` bytes, with exponentially distributed gaps like
+// heap profilers do. Sampled allocations live in an open-addressing hash table
+// keyed by pointer, so both record and release are O(1). check_leaks scales
+// each sample by its inverse sampling probability and groups the estimate by
+// call site.
+// ---------------------------------------------------------------------------
+
+static size_t ptr_hash(const void* ptr, size_t capacity) {
+    // blocks are ALIGNMENT-aligned, so drop the always-zero low bits
+    uint64_t key = (uint64_t)(uintptr_t)ptr >> 4;
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+
+static void table_insert_slot(allocation_info_t* slots, size_t capacity,
+                              const allocation_info_t* info) {
+    size_t i = ptr_hash(info->ptr, capacity);
+    while (slots[i].ptr != NULL && slots[i].ptr != TRACK_DELETED) {
+        i = (i + 1) & (capacity - 1);
+    }
+    slots[i] = *info;
+}
+
+
+// rehash into a table sized for the live entries, dropping deleted slots
+static bool table_grow() {
+    size_t capacity = tracked.capacity ? tracked.capacity : TRACK_INITIAL_CAPACITY;
+    while ((tracked.live + 1) >= capacity * TRACK_MAX_LOAD / 2) {
+        capacity *= 2;
+    }
+
+    allocation_info_t* slots = calloc(capacity, sizeof(allocation_info_t));
+    if (!slots) return false;
+
+    for (size_t i = 0; i < tracked.capacity; ++i) {
+        if (tracked.slots[i].ptr != NULL && tracked.slots[i].ptr != TRACK_DELETED) {
+            table_insert_slot(slots, capacity, &tracked.slots[i]);
+        }
+    }
+
+    free(tracked.slots);
+    tracked.slots = slots;
+    tracked.capacity = capacity;
+    tracked.deleted = 0;
+    return true;
+}
+
+
+// inverse probability that an allocation of `size` bytes was sampled
+static double sample_weight(size_t size) {
+    if (sample_rate == 0) return 1.0;
+    return 1.0 / (1.0 - exp(-(double)size / sample_rate));
+}
+
+
+static void track_allocation(void* ptr, size_t size, const char* file, int line) {
+    if (tracked.live + tracked.deleted + 1 > tracked.capacity * TRACK_MAX_LOAD) {
+        if (!table_grow()) return;
+    }
+
+    allocation_info_t info = { ptr, size, file, line, sample_weight(size) };
+    table_insert_slot(tracked.slots, tracked.capacity, &info);
+    tracked.live++;
+}
+
+
+static void untrack_allocation(void* ptr) {
+    if (tracked.live == 0) return;
+
+    size_t i = ptr_hash(ptr, tracked.capacity);
+    while (tracked.slots[i].ptr != NULL) {
+        if (tracked.slots[i].ptr == ptr) {
+            tracked.slots[i].ptr = TRACK_DELETED;
+            tracked.live--;
+            tracked.deleted++;
+            return;
+        }
+        i = (i + 1) & (tracked.capacity - 1);
+    }
+}
+
+
+// exponentially distributed gap with mean sample_rate
+static long long next_sample_gap() {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return (long long)(-log(u) * sample_rate);
+}
+
+
+// mean number of bytes between samples; 0 records every allocation
+void set_sample_rate(size_t rate) {
+    sample_rate = rate;
+    bytes_until_sample = rate ? next_sample_gap() : 0;
 }
 
 
 void* debug_malloc(size_t size, const char* file, int line) {
     void* ptr = custom_malloc(size);
-    if (ptr && alloc_cnt < MAX_ALLOC) {
-        allocations[alloc_cnt].ptr = ptr;
-        allocations[alloc_cnt].size = size;
-        allocations[alloc_cnt].file = file;
-        allocations[alloc_cnt].line = line;
-        alloc_cnt++;
+    if (!ptr) return NULL;
+
+    bytes_until_sample -= (long long)size;
+    if (bytes_until_sample < 0) {
+        track_allocation(ptr, size, file, line);
+        bytes_until_sample = sample_rate ? next_sample_gap() : 0;
     }
 
     return ptr;
@@ -292,30 +772,296 @@ void* debug_malloc(size_t size, const char* file, int line) {
 
 
 void debug_free(void* ptr, const char* file, int line) {
-    for (int i = 0; i < alloc_cnt; ++i) {
-        if (allocations[i].ptr == ptr) {
-            memmove(&allocations[i], &allocations[i + 1], 
-                    (alloc_cnt - i - 1) * sizeof(allocation_info_t));
+    (void)file;
+    (void)line;
+
+    untrack_allocation(ptr);
+    custom_free(ptr);
+}
+
+
+#define debug_malloc_here(size) debug_malloc((size), __FILE__, __LINE__)
+#define debug_free_here(ptr) debug_free((ptr), __FILE__, __LINE__)
+
+
+typedef struct {
+    const char* file;
+    int line;
+    double count;   // estimated live allocations
+    double bytes;   // estimated live bytes
+} leak_site_t;
 
-            alloc_cnt--;
-            break;                    
+
+static int compare_by_site(const void* a, const void* b) {
+    const allocation_info_t* x = (const allocation_info_t*)a;
+    const allocation_info_t* y = (const allocation_info_t*)b;
+    if (x->file != y->file) return x->file < y->file ? -1 : 1;
+    return x->line - y->line;
+}
+
+
+static int compare_by_bytes(const void* a, const void* b) {
+    const leak_site_t* x = (const leak_site_t*)a;
+    const leak_site_t* y = (const leak_site_t*)b;
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+
+void check_leaks() {
+    if (tracked.live == 0) {
+        printf("No memory leaks detected\n");
+        return;
+    }
+
+    // gather live samples and group them by call site
+    allocation_info_t* live = malloc(tracked.live * sizeof(allocation_info_t));
+    leak_site_t* sites = malloc(tracked.live * sizeof(leak_site_t));
+    if (!live || !sites) {
+        free(live);
+        free(sites);
+        return;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < tracked.capacity; ++i) {
+        if (tracked.slots[i].ptr != NULL && tracked.slots[i].ptr != TRACK_DELETED) {
+            live[n++] = tracked.slots[i];
+        }
+    }
+    qsort(live, n, sizeof(allocation_info_t), compare_by_site);
+
+    size_t num_sites = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (num_sites == 0 || compare_by_site(&live[i], &live[i - 1]) != 0) {
+            sites[num_sites++] = (leak_site_t){ live[i].file, live[i].line, 0, 0 };
         }
+        sites[num_sites - 1].count += live[i].weight;
+        sites[num_sites - 1].bytes += live[i].weight * live[i].size;
     }
+    qsort(sites, num_sites, sizeof(leak_site_t), compare_by_bytes);
+
+    printf("Memory Leaks Detected:\n");
+    for (size_t i = 0; i < num_sites; ++i) {
+        printf("Leak: ~%.0f bytes in ~%.0f allocations, allocated in %s:%d\n",
+                sites[i].bytes, sites[i].count, sites[i].file, sites[i].line);
+    }
+
+    free(live);
+    free(sites);
+}
+
+
+// ---------------------------------------------------------------------------
+// Thread-safe variant: per-thread caches over the shared heap (tcmalloc style)
+//
+// Each thread keeps a small stack of free blocks per size class. ts_malloc and
+// ts_free touch only that stack; the heap lock is taken once per TCACHE_BATCH
+// blocks to refill from, or flush to, the central bins. Large requests go
+// straight to the heap under the lock. Cached small blocks are not linked into
+// heap.used_list, and their used_size changes are folded in at batch time.
+// Blocks from ts_malloc must be released with ts_free.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    block_t* bins[NUM_SIZE_CLASSES];
+    size_t count[NUM_SIZE_CLASSES];
+    long long used_delta;   // used_size change not yet published to the heap
+} thread_cache_t;
+
+
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread thread_cache_t tcache;
+
+
+// move up to TCACHE_BATCH blocks from the central bin into this thread's cache
+static bool tcache_refill(int idx) {
+    pthread_mutex_lock(&heap_lock);
+
+    heap.used_size += tcache.used_delta;
+    tcache.used_delta = 0;
+
+    for (int n = 0; n < TCACHE_BATCH; ++n) {
+        if (heap.bins[idx] == NULL && !refill_bin(idx)) break;
+
+        block_t* block = heap.bins[idx];
+        heap.bins[idx] = block->next;
+        heap.bin_count[idx]--;
+
+        block->next = tcache.bins[idx];
+        tcache.bins[idx] = block;
+        tcache.count[idx]++;
+    }
+
+    pthread_mutex_unlock(&heap_lock);
+
+    return tcache.bins[idx] != NULL;
+}
+
+
+// return up to `n` blocks of one class from this thread's cache to the central bin
+static void tcache_flush(int idx, size_t n) {
+    pthread_mutex_lock(&heap_lock);
+
+    heap.used_size += tcache.used_delta;
+    tcache.used_delta = 0;
+
+    while (n-- > 0 && tcache.bins[idx]) {
+        block_t* block = tcache.bins[idx];
+        tcache.bins[idx] = block->next;
+        tcache.count[idx]--;
+
+        block->next = heap.bins[idx];
+        heap.bins[idx] = block;
+        heap.bin_count[idx]++;
+    }
+
+    pthread_mutex_unlock(&heap_lock);
+}
+
+
+void* ts_malloc(size_t size) {
+    if (size == 0) return NULL;
+
+    size_t total_size = REQUEST_SIZE(size);
+    int idx = size_class_index(total_size);
+
+    if (idx < 0) {
+        pthread_mutex_lock(&heap_lock);
+        void* ptr = custom_malloc(size);
+        pthread_mutex_unlock(&heap_lock);
+        return ptr;
+    }
+
+    if (tcache.bins[idx] == NULL && !tcache_refill(idx)) {
+        return NULL;
+    }
+
+    block_t* block = tcache.bins[idx];
+    tcache.bins[idx] = block->next;
+    tcache.count[idx]--;
+    tcache.used_delta += block->size;
+
+    return block->data;
+}
+
+
+void ts_free(void* ptr) {
+    if (!ptr) return;
+
+    block_t* block = (block_t*)((char*)ptr - BLOCK_SIZE);
+
+    // binned blocks are exactly one class size; anything bigger came from the heap
+    if (block->size > MAX_CLASS_SIZE) {
+        pthread_mutex_lock(&heap_lock);
+        custom_free(ptr);
+        pthread_mutex_unlock(&heap_lock);
+        return;
+    }
+
+    int idx = size_class_index(block->size);
+    block->next = tcache.bins[idx];
+    tcache.bins[idx] = block;
+    tcache.count[idx]++;
+    tcache.used_delta -= block->size;
+
+    if (tcache.count[idx] > TCACHE_MAX) {
+        tcache_flush(idx, TCACHE_BATCH);
+    }
+}
+
+
+// hand this thread's cached blocks back to the heap; call before a worker exits
+void ts_thread_exit() {
+    for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+        tcache_flush(i, tcache.count[i]);
+    }
+}
+
+
+// mutex-wrapped baseline for the benchmark
+static void* locked_malloc(size_t size) {
+    pthread_mutex_lock(&heap_lock);
+    void* ptr = custom_malloc(size);
+    pthread_mutex_unlock(&heap_lock);
+    return ptr;
+}
+
+
+static void locked_free(void* ptr) {
+    pthread_mutex_lock(&heap_lock);
     custom_free(ptr);
+    pthread_mutex_unlock(&heap_lock);
 }
 
 
-void check_leaks() {
-    if (alloc_cnt > 0) {
-        printf("Memory Leaks Detected:\n");
-        for (int i = 0; i < alloc_cnt; ++i) {
-            printf("Leak: %zu bytes at %p, allocated in %s:%d\n",
-                    allocations[i].size, allocations[i].ptr,
-                    allocations[i].file, allocations[i].line);
+#define BENCH_OPS 200000
+#define BENCH_LIVE 64       // live allocations each worker keeps around
+
+typedef struct {
+    void* (*alloc_fn)(size_t);
+    void (*free_fn)(void*);
+    bool thread_cached;
+    unsigned int seed;
+} bench_arg_t;
+
+
+static void* bench_worker(void* arg) {
+    bench_arg_t* b = (bench_arg_t*)arg;
+    void* live[BENCH_LIVE] = {0};
+
+    for (int i = 0; i < BENCH_OPS; ++i) {
+        int slot = rand_r(&b->seed) % BENCH_LIVE;
+        if (live[slot]) {
+            b->free_fn(live[slot]);
         }
+        live[slot] = b->alloc_fn(16 + rand_r(&b->seed) % 1000);
     }
-    else {
-        printf("No memory leaks detected\n");
+    for (int i = 0; i < BENCH_LIVE; ++i) {
+        b->free_fn(live[i]);
+    }
+
+    if (b->thread_cached) {
+        ts_thread_exit();
+    }
+    return NULL;
+}
+
+
+static double run_alloc_bench(int num_threads, bool thread_cached) {
+    pthread_t threads[num_threads];
+    bench_arg_t args[num_threads];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_threads; ++i) {
+        args[i].alloc_fn = thread_cached ? ts_malloc : locked_malloc;
+        args[i].free_fn = thread_cached ? ts_free : locked_free;
+        args[i].thread_cached = thread_cached;
+        args[i].seed = i + 1;
+        pthread_create(&threads[i], NULL, bench_worker, &args[i]);
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double)num_threads * BENCH_OPS / secs;
+}
+
+
+// multi-threaded alloc/free throughput: global lock vs per-thread caches
+void benchmark_thread_caches() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+
+    printf("\nAlloc/Free Throughput (ops/sec):\n");
+    printf("%-8s %-16s %s\n", "Threads", "Locked heap", "Thread caches");
+
+    for (int n = 1; n <= cores; n *= 2) {
+        double locked = run_alloc_bench(n, false);
+        double cached = run_alloc_bench(n, true);
+        printf("%-8d %-16.0f %.0f\n", n, locked, cached);
     }
 }
 
@@ -338,6 +1084,52 @@ int main() {
     custom_free(numbers);
     custom_free(string);
 
+    // a burst of large buffers is served by mmap and handed back on free
+    void* large[4];
+    for (int i = 0; i < 4; ++i) {
+        large[i] = custom_malloc(512 * 1024);
+    }
+    printf("\nMmapped after large burst: %zu blocks, %zu bytes\n",
+            heap.mmap_count, heap.mmap_size);
+    for (int i = 0; i < 4; ++i) {
+        custom_free(large[i]);
+    }
+
+    // give unused heap pages back to the OS
+    printf("Trim released memory: %s\n", custom_malloc_trim(0) ? "yes" : "no");
+
+    // small allocations served from size-class bins
+    set_allocator_mode(ALLOC_MODE_SIZE_CLASS);
+
+    void* small[32];
+    for (int i = 0; i < 32; ++i) {
+        small[i] = custom_malloc(16 + (i % 4) * 100);
+    }
+    for (int i = 0; i < 32; ++i) {
+        custom_free(small[i]);
+    }
+
+    print_memory_stats();
+
+    set_allocator_mode(ALLOC_MODE_BEST_FIT);
+
+    benchmark_thread_caches();
+    printf("External fragmentation after churn: %.2f%%\n",
+            external_fragmentation() * 100);
+
+    // exact leak tracking
+    set_sample_rate(0);
+    void* kept = debug_malloc_here(200);
+    debug_malloc_here(48);      // leaked on purpose
+    debug_free_here(kept);
+    check_leaks();
+
+    // sampled tracking, cheap enough to leave on in production
+    set_sample_rate(64 * 1024);
+    for (int i = 0; i < 20000; ++i) {
+        void* p = debug_malloc_here(64);
+        if (i % 2) debug_free_here(p);      // every other allocation leaks
+    }
     check_leaks();
 
     return 0;
@@ -2,10 +2,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 
 #define POOL_BLOCK_SIZE 64
 #define POOL_BLOCK_COUNT 1024
 
+#define MAGAZINE_SIZE 64        // blocks a thread can hold without touching the shared stack
+#define MAGAZINE_BATCH 32       // blocks moved per refill / flush
+#define MAX_THREAD_POOLS 8      // concurrent pools a single thread can use
+
+#define SLAB_MIN_SIZE 4096      // slabs are power-of-two sized and aligned to their size
+
 
 typedef struct MemoryPool {
     void* start;
@@ -29,7 +39,7 @@ typedef struct AdvancedMemoryPool {
 
 
 static size_t align_size(size_t size, size_t alignment) {
-    return (size + (alignment - 1)) & !(alignment - 1);
+    return (size + (alignment - 1)) & ~(alignment - 1);
     // equals to: size_t aligned_size = ((size + alignment - 1) / alignment) * alignment;
 }
 
@@ -86,7 +96,6 @@ void pool_free(MemoryPool* pool, void* block) {
 void pool_destroy(MemoryPool* pool) {
     if (!pool) return;
     free(pool->start);
-    free(pool->free_list);
     free(pool);
 }
 
@@ -127,6 +136,497 @@ AdvancedMemoryPool* advanced_pool_create(
     return pool;
 }
 
+// ---------------------------------------------------------------------------
+// Concurrent pool: per-thread magazines over a lock-free global stack
+//
+// Each thread keeps a magazine (a small array) of free blocks per pool, so the
+// common alloc/free is a push or pop on thread-local memory. Only when the
+// magazine runs empty or full does the thread move MAGAZINE_BATCH blocks from
+// or to the shared Treiber stack. The stack head packs a block index and a
+// version tag into one 64-bit word; every successful CAS bumps the tag, so a
+// head that was popped and pushed back in between (ABA) fails the CAS.
+// Blocks live in one slab for the pool's lifetime, so reading a stale `next`
+// link is always safe.
+// ---------------------------------------------------------------------------
+
+typedef struct ConcurrentPool {
+    char* start;
+    size_t block_size;
+    size_t total_blocks;
+    _Atomic uint64_t head;      // (tag << 32) | (index + 1), 0 when empty
+} ConcurrentPool;
+
+
+typedef struct {
+    ConcurrentPool* pool;
+    void* blocks[MAGAZINE_SIZE];
+    size_t count;
+} Magazine;
+
+
+static __thread Magazine magazines[MAX_THREAD_POOLS];
+
+
+#define HEAD_INDEX(head) ((uint32_t)(head))
+#define HEAD_TAG(head) ((uint32_t)((head) >> 32))
+#define MAKE_HEAD(tag, index) (((uint64_t)(tag) << 32) | (uint32_t)(index))
+
+
+// blocks are linked by index (+1, so 0 ends the list) stored in their first word
+static uint32_t block_index(ConcurrentPool* pool, void* block) {
+    return (uint32_t)(((char*)block - pool->start) / pool->block_size) + 1;
+}
+
+
+static void* index_block(ConcurrentPool* pool, uint32_t index) {
+    return pool->start + (size_t)(index - 1) * pool->block_size;
+}
+
+
+static uint32_t* block_next(void* block) {
+    return (uint32_t*)block;
+}
+
+
+// push a pre-linked chain first..last onto the shared stack with one CAS
+static void stack_push_chain(ConcurrentPool* pool, void* first, void* last) {
+    uint64_t old_head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    uint64_t new_head;
+
+    do {
+        *block_next(last) = HEAD_INDEX(old_head);
+        new_head = MAKE_HEAD(HEAD_TAG(old_head) + 1, block_index(pool, first));
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &old_head, new_head,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+
+static void* stack_pop(ConcurrentPool* pool) {
+    uint64_t old_head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    uint64_t new_head;
+
+    do {
+        if (HEAD_INDEX(old_head) == 0) return NULL;
+        void* block = index_block(pool, HEAD_INDEX(old_head));
+        new_head = MAKE_HEAD(HEAD_TAG(old_head) + 1, *block_next(block));
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &old_head, new_head,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return index_block(pool, HEAD_INDEX(old_head));
+}
+
+
+ConcurrentPool* cpool_create(size_t block_size, size_t block_count) {
+    if (block_count == 0 || block_count >= UINT32_MAX) return NULL;
+
+    ConcurrentPool* pool = malloc(sizeof(ConcurrentPool));
+    if (!pool) return NULL;
+
+    pool->block_size = align_size(block_size < sizeof(uint32_t) ? sizeof(uint32_t) : block_size,
+                                  sizeof(void*));
+    pool->total_blocks = block_count;
+    pool->start = malloc(pool->block_size * block_count);
+    if (!pool->start) {
+        free(pool);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < block_count; ++i) {
+        void* block = index_block(pool, (uint32_t)i + 1);
+        *block_next(block) = (i + 1 < block_count) ? (uint32_t)i + 2 : 0;
+    }
+    atomic_init(&pool->head, MAKE_HEAD(0, 1));
+
+    return pool;
+}
+
+
+// find (or claim) this thread's magazine for the pool
+static Magazine* thread_magazine(ConcurrentPool* pool) {
+    Magazine* empty = NULL;
+    for (int i = 0; i < MAX_THREAD_POOLS; ++i) {
+        if (magazines[i].pool == pool) return &magazines[i];
+        if (!empty && magazines[i].pool == NULL) empty = &magazines[i];
+    }
+
+    if (empty) {
+        empty->pool = pool;
+        empty->count = 0;
+    }
+    return empty;
+}
+
+
+// move up to `n` blocks from the magazine back to the shared stack
+static void magazine_flush(Magazine* mag, size_t n) {
+    if (n > mag->count) n = mag->count;
+    if (n == 0) return;
+
+    // link the top n blocks into a chain and publish it in one CAS
+    void* first = mag->blocks[mag->count - 1];
+    for (size_t i = mag->count - 1; i > mag->count - n; --i) {
+        *block_next(mag->blocks[i]) = block_index(mag->pool, mag->blocks[i - 1]);
+    }
+    void* last = mag->blocks[mag->count - n];
+
+    stack_push_chain(mag->pool, first, last);
+    mag->count -= n;
+}
+
+
+void* cpool_alloc(ConcurrentPool* pool) {
+    Magazine* mag = thread_magazine(pool);
+    if (!mag) return stack_pop(pool);   // out of magazine slots: go straight to the stack
+
+    if (mag->count == 0) {
+        while (mag->count < MAGAZINE_BATCH) {
+            void* block = stack_pop(pool);
+            if (!block) break;
+            mag->blocks[mag->count++] = block;
+        }
+        if (mag->count == 0) return NULL;
+    }
+
+    return mag->blocks[--mag->count];
+}
+
+
+void cpool_free(ConcurrentPool* pool, void* block) {
+    if (!block) return;
+
+    Magazine* mag = thread_magazine(pool);
+    if (!mag) {
+        stack_push_chain(pool, block, block);
+        return;
+    }
+
+    if (mag->count == MAGAZINE_SIZE) {
+        magazine_flush(mag, MAGAZINE_BATCH);
+    }
+    mag->blocks[mag->count++] = block;
+}
+
+
+// return this thread's cached blocks to the pool; call before a worker exits
+void cpool_thread_exit(ConcurrentPool* pool) {
+    Magazine* mag = thread_magazine(pool);
+    if (!mag) return;
+
+    magazine_flush(mag, mag->count);
+    mag->pool = NULL;
+}
+
+
+// all threads must have called cpool_thread_exit first
+void cpool_destroy(ConcurrentPool* pool) {
+    if (!pool) return;
+    free(pool->start);
+    free(pool);
+}
+
+
+// ---------------------------------------------------------------------------
+// Slab pool: growable, lazily initialized MemoryPool
+//
+// Memory comes in slabs that are aligned to their own (power-of-two) size, so
+// the slab owning a block is found by masking the block address. A new slab
+// only writes its header: blocks are handed out with a bump pointer and a
+// slab's free list only ever holds blocks that were actually freed, so pages
+// are touched on first use instead of at creation. Slabs are added when the
+// pool runs dry, and a slab whose blocks are all free is released (one empty
+// slab is kept to avoid thrashing at the boundary).
+// ---------------------------------------------------------------------------
+
+typedef struct Slab {
+    struct Slab* next;
+    struct Slab* prev;
+    char* bump;             // next never-used block
+    char* end;
+    void* free_list;        // blocks freed back to this slab
+    size_t used;
+} Slab;
+
+
+typedef struct SlabPool {
+    Slab* partial;          // slabs with at least one available block
+    Slab* full;
+    Slab* empty;            // cached fully free slab
+    size_t block_size;
+    size_t slab_size;
+    size_t blocks_per_slab;
+    size_t slab_count;
+    size_t used_blocks;
+} SlabPool;
+
+
+static void slab_list_remove(Slab** list, Slab* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    }
+    else {
+        *list = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+
+static void slab_list_push(Slab** list, Slab* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list) {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+
+static size_t slab_header_size(size_t block_size) {
+    return align_size(sizeof(Slab), block_size < 64 ? block_size : 64);
+}
+
+
+SlabPool* slab_pool_create(size_t block_size, size_t blocks_per_slab) {
+    SlabPool* pool = malloc(sizeof(SlabPool));
+    if (!pool) return NULL;
+
+    pool->block_size = align_size(block_size < sizeof(void*) ? sizeof(void*) : block_size,
+                                  sizeof(void*));
+
+    size_t wanted = slab_header_size(pool->block_size) + pool->block_size * blocks_per_slab;
+    pool->slab_size = SLAB_MIN_SIZE;
+    while (pool->slab_size < wanted) {
+        pool->slab_size <<= 1;
+    }
+
+    pool->blocks_per_slab = (pool->slab_size - slab_header_size(pool->block_size)) / pool->block_size;
+    pool->partial = NULL;
+    pool->full = NULL;
+    pool->empty = NULL;
+    pool->slab_count = 0;
+    pool->used_blocks = 0;
+
+    return pool;
+}
+
+
+static Slab* slab_new(SlabPool* pool) {
+    void* memory;
+    if (posix_memalign(&memory, pool->slab_size, pool->slab_size) != 0) {
+        return NULL;
+    }
+
+    // only the header is written; the block area stays untouched
+    Slab* slab = (Slab*)memory;
+    slab->bump = (char*)memory + slab_header_size(pool->block_size);
+    slab->end = slab->bump + pool->blocks_per_slab * pool->block_size;
+    slab->free_list = NULL;
+    slab->used = 0;
+
+    pool->slab_count++;
+    return slab;
+}
+
+
+void* slab_pool_alloc(SlabPool* pool) {
+    if (!pool) return NULL;
+
+    Slab* slab = pool->partial;
+    if (!slab) {
+        if (pool->empty) {
+            slab = pool->empty;
+            pool->empty = NULL;
+        }
+        else {
+            slab = slab_new(pool);
+            if (!slab) return NULL;
+        }
+        slab_list_push(&pool->partial, slab);
+    }
+
+    void* block;
+    if (slab->free_list) {
+        block = slab->free_list;
+        slab->free_list = *(void**)block;
+    }
+    else {
+        block = slab->bump;
+        slab->bump += pool->block_size;
+    }
+
+    slab->used++;
+    pool->used_blocks++;
+
+    if (slab->used == pool->blocks_per_slab) {
+        slab_list_remove(&pool->partial, slab);
+        slab_list_push(&pool->full, slab);
+    }
+
+    return block;
+}
+
+
+void slab_pool_free(SlabPool* pool, void* block) {
+    if (!pool || !block) return;
+
+    Slab* slab = (Slab*)((uintptr_t)block & ~(uintptr_t)(pool->slab_size - 1));
+
+    if (slab->used == pool->blocks_per_slab) {
+        slab_list_remove(&pool->full, slab);
+        slab_list_push(&pool->partial, slab);
+    }
+
+    *(void**)block = slab->free_list;
+    slab->free_list = block;
+    slab->used--;
+    pool->used_blocks--;
+
+    if (slab->used == 0) {
+        slab_list_remove(&pool->partial, slab);
+
+        // reset to the lazy state so a reused slab bumps from the start again
+        slab->bump = (char*)slab + slab_header_size(pool->block_size);
+        slab->free_list = NULL;
+
+        if (pool->empty) {
+            free(pool->empty);
+            pool->slab_count--;
+        }
+        pool->empty = slab;
+    }
+}
+
+
+// release the cached empty slab, if any
+void slab_pool_shrink(SlabPool* pool) {
+    if (pool && pool->empty) {
+        free(pool->empty);
+        pool->empty = NULL;
+        pool->slab_count--;
+    }
+}
+
+
+void slab_pool_destroy(SlabPool* pool) {
+    if (!pool) return;
+
+    Slab* lists[] = { pool->partial, pool->full };
+    for (int i = 0; i < 2; ++i) {
+        Slab* slab = lists[i];
+        while (slab) {
+            Slab* next = slab->next;
+            free(slab);
+            slab = next;
+        }
+    }
+    free(pool->empty);
+    free(pool);
+}
+
+
+// ---------------------------------------------------------------------------
+// Contention benchmark: mutex-wrapped MemoryPool vs ConcurrentPool
+// ---------------------------------------------------------------------------
+
+#define BENCH_ROUNDS 100000
+#define BENCH_BURST 16          // blocks each thread holds at once
+
+typedef struct {
+    MemoryPool* pool;
+    pthread_mutex_t lock;
+} LockedPool;
+
+
+typedef struct {
+    LockedPool* locked;
+    ConcurrentPool* concurrent;
+} BenchArg;
+
+
+static void* locked_worker(void* arg) {
+    LockedPool* lp = ((BenchArg*)arg)->locked;
+    void* held[BENCH_BURST];
+
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        for (int i = 0; i < BENCH_BURST; ++i) {
+            pthread_mutex_lock(&lp->lock);
+            held[i] = pool_alloc(lp->pool);
+            pthread_mutex_unlock(&lp->lock);
+        }
+        for (int i = 0; i < BENCH_BURST; ++i) {
+            pthread_mutex_lock(&lp->lock);
+            pool_free(lp->pool, held[i]);
+            pthread_mutex_unlock(&lp->lock);
+        }
+    }
+    return NULL;
+}
+
+
+static void* concurrent_worker(void* arg) {
+    ConcurrentPool* pool = ((BenchArg*)arg)->concurrent;
+    void* held[BENCH_BURST];
+
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        for (int i = 0; i < BENCH_BURST; ++i) {
+            held[i] = cpool_alloc(pool);
+        }
+        for (int i = 0; i < BENCH_BURST; ++i) {
+            cpool_free(pool, held[i]);
+        }
+    }
+
+    cpool_thread_exit(pool);
+    return NULL;
+}
+
+
+static double run_pool_bench(int num_threads, void* (*worker)(void*), BenchArg* arg) {
+    pthread_t threads[num_threads];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_create(&threads[i], NULL, worker, arg);
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return 2.0 * num_threads * BENCH_ROUNDS * BENCH_BURST / secs;
+}
+
+
+void benchmark_pools() {
+    LockedPool locked = { pool_init(POOL_BLOCK_SIZE, POOL_BLOCK_COUNT),
+                          PTHREAD_MUTEX_INITIALIZER };
+    ConcurrentPool* concurrent = cpool_create(POOL_BLOCK_SIZE, POOL_BLOCK_COUNT);
+    BenchArg arg = { &locked, concurrent };
+
+    if (!locked.pool || !concurrent) {
+        printf("Failed to create benchmark pools\n");
+        return;
+    }
+
+    printf("\nPool Alloc/Free Throughput (ops/sec):\n");
+    printf("%-8s %-16s %s\n", "Threads", "Mutex pool", "Magazine pool");
+
+    for (int n = 1; n <= 8; n *= 2) {
+        double mutex_ops = run_pool_bench(n, locked_worker, &arg);
+        double magazine_ops = run_pool_bench(n, concurrent_worker, &arg);
+        printf("%-8d %-16.0f %.0f\n", n, mutex_ops, magazine_ops);
+    }
+
+    pool_destroy(locked.pool);
+    cpool_destroy(concurrent);
+}
+
+
 int main() {
     MemoryPool* pool = pool_init(POOL_BLOCK_SIZE, POOL_BLOCK_COUNT);
     AdvancedMemoryPool* advanced_pool = advanced_pool_create(POOL_BLOCK_SIZE, POOL_BLOCK_COUNT, 8);
@@ -164,6 +664,48 @@ int main() {
 
     pool_destroy(pool);
     pool_destroy(advanced_pool);
+
+    // slab pool grows past its first slab and gives slabs back when drained
+    SlabPool* slab_pool = slab_pool_create(POOL_BLOCK_SIZE, POOL_BLOCK_COUNT);
+    if (!slab_pool) {
+        printf("Failed to create slab pool\n");
+        return 1;
+    }
+
+    size_t burst = 5 * POOL_BLOCK_COUNT;
+    void** held = malloc(burst * sizeof(void*));
+    for (size_t i = 0; i < burst; ++i) {
+        held[i] = slab_pool_alloc(slab_pool);
+    }
+    printf("\nSlab pool after %zu allocations: %zu slabs\n", burst, slab_pool->slab_count);
+
+    for (size_t i = 0; i < burst; ++i) {
+        slab_pool_free(slab_pool, held[i]);
+    }
+    slab_pool_shrink(slab_pool);
+    printf("Slab pool after freeing all blocks: %zu slabs\n", slab_pool->slab_count);
+
+    free(held);
+    slab_pool_destroy(slab_pool);
+
+    // startup cost of a large pool: eager free-list threading vs lazy slabs
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    MemoryPool* eager = pool_init(POOL_BLOCK_SIZE, 1 << 20);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    SlabPool* lazy = slab_pool_create(POOL_BLOCK_SIZE, 1 << 14);
+    void* first = slab_pool_alloc(lazy);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    printf("Create + first alloc, large pool: eager (1M blocks) %.3f ms, slab (grows on demand) %.3f ms\n",
+           ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e6,
+           ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) / 1e6);
+
+    slab_pool_free(lazy, first);
+    slab_pool_destroy(lazy);
+    pool_destroy(eager);
+
+    benchmark_pools();
     
     return 0;
 }
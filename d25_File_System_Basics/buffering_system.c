@@ -2,9 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <aio.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 #define BUFFER_SIZE 4096
+#define BYPASS_THRESHOLD BUFFER_SIZE    // requests this large skip the buffer copy
+#define MAX_BATCH_IOV 64                // pieces gathered into one writev
 
 
 typedef struct Buffer {
@@ -19,6 +27,9 @@ typedef struct BufferedFile {
     int fd;
     Buffer buffer;
     int mode;   // read or write
+    char *map;          // whole-file mapping in mmap read mode, NULL otherwise
+    size_t map_size;
+    size_t map_pos;
 } BufferedFile;
 
 
@@ -31,16 +42,73 @@ BufferedFile *create_buffered_file(int fd, int mode) {
     bf->buffer.size = 0;
     bf->buffer.position = 0;
     bf->buffer.dirty = 0;
+    bf->map = NULL;
+    bf->map_size = 0;
+    bf->map_pos = 0;
 
     return bf;
 }
 
 
+// read-only file served straight from a private mapping of the whole file;
+// suited to sequential scans, no read() calls and no buffer copy
+BufferedFile *create_mapped_file(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) return NULL;
+
+    BufferedFile *bf = create_buffered_file(fd, O_RDONLY);
+    if (!bf || st.st_size == 0) return bf;
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        free(bf);
+        return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    bf->map = map;
+    bf->map_size = st.st_size;
+    return bf;
+}
+
+
+void close_buffered_file(BufferedFile *bf) {
+    if (!bf) return;
+    if (bf->map) {
+        munmap(bf->map, bf->map_size);
+    }
+    free(bf);
+}
+
+
+// writev until every byte is out; advances a copy of the iovec array in place
+static int writev_all(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+
 int buffer_flush(BufferedFile *bf) {
-    if (!bf || bf->buffer.dirty) return 0;
+    if (!bf || !bf->buffer.dirty) return 0;
 
-    ssize_t written = write(bf->fd, bf->buffer.data, bf->buffer.size);
-    if (written < 0) return -1;
+    struct iovec iov = { bf->buffer.data, bf->buffer.size };
+    if (writev_all(bf->fd, &iov, 1) < 0) return -1;
 
     bf->buffer.size = 0;
     bf->buffer.position = 0;
@@ -56,11 +124,28 @@ ssize_t buffer_read(BufferedFile *bf, void *data, size_t count) {
     size_t total_read = 0;
     char *dest = (char*)data;
 
+    if (bf->map) {
+        size_t available = bf->map_size - bf->map_pos;
+        size_t to_copy = count < available ? count : available;
+        memcpy(dest, bf->map + bf->map_pos, to_copy);
+        bf->map_pos += to_copy;
+        return to_copy;
+    }
+
     while (total_read < count) {
         // if buffer is empty, fill it
         if (bf->buffer.position >= bf->buffer.size) {
-            bf->buffer.size = read(bf->fd, bf->buffer.data, BUFFER_SIZE);
-            if (bf->buffer.size <= 0) break;
+            // large remainder: read straight into the caller's memory
+            if (count - total_read >= BYPASS_THRESHOLD) {
+                ssize_t bytes = read(bf->fd, dest + total_read, count - total_read);
+                if (bytes <= 0) break;
+                total_read += bytes;
+                continue;
+            }
+
+            ssize_t bytes = read(bf->fd, bf->buffer.data, BUFFER_SIZE);
+            if (bytes <= 0) break;
+            bf->buffer.size = bytes;
             bf->buffer.position = 0;
         }
 
@@ -82,11 +167,29 @@ ssize_t buffer_read(BufferedFile *bf, void *data, size_t count) {
 
 
 ssize_t buffer_write(BufferedFile *bf, const void *data, size_t count) {
-    if (!bf || bf->mode != O_RDONLY) return -1;
+    if (!bf || bf->mode == O_RDONLY) return -1;
 
     size_t total_written = 0;
     const char *src = (const char*)data;
 
+    // large request: send the pending buffer and the caller's data together
+    // in one writev instead of copying the data through the buffer
+    if (count >= BYPASS_THRESHOLD) {
+        struct iovec iov[2];
+        int iovcnt = 0;
+        if (bf->buffer.size > 0) {
+            iov[iovcnt++] = (struct iovec){ bf->buffer.data, bf->buffer.size };
+        }
+        iov[iovcnt++] = (struct iovec){ (void*)src, count };
+
+        if (writev_all(bf->fd, iov, iovcnt) < 0) return -1;
+
+        bf->buffer.size = 0;
+        bf->buffer.position = 0;
+        bf->buffer.dirty = 0;
+        return count;
+    }
+
     while (total_written < count) {
         // if buffer is full, flush it
         if (bf->buffer.size >= BUFFER_SIZE) {
@@ -111,9 +214,342 @@ ssize_t buffer_write(BufferedFile *bf, const void *data, size_t count) {
 }
 
 
+// zero-copy view of the next `*len` bytes (at most `max`) in mmap read mode;
+// returns NULL at end of file or when the file is not mapped
+const char *buffer_read_view(BufferedFile *bf, size_t max, size_t *len) {
+    if (!bf || !bf->map || bf->map_pos >= bf->map_size) {
+        *len = 0;
+        return NULL;
+    }
+
+    size_t available = bf->map_size - bf->map_pos;
+    *len = max < available ? max : available;
+
+    const char *view = bf->map + bf->map_pos;
+    bf->map_pos += *len;
+    return view;
+}
+
+
+// write many pieces with as few syscalls as possible: pieces that fit are
+// appended to the buffer, and once they no longer fit the buffer and the
+// remaining pieces (up to MAX_BATCH_IOV) go out in a single writev
+ssize_t buffer_write_batch(BufferedFile *bf, const struct iovec *pieces, int count) {
+    if (!bf || bf->mode == O_RDONLY) return -1;
+
+    size_t total = 0;
+    int i = 0;
+
+    while (i < count) {
+        if (bf->buffer.size + pieces[i].iov_len <= BUFFER_SIZE) {
+            memcpy(bf->buffer.data + bf->buffer.size, pieces[i].iov_base, pieces[i].iov_len);
+            bf->buffer.size += pieces[i].iov_len;
+            bf->buffer.dirty = 1;
+            total += pieces[i].iov_len;
+            i++;
+            continue;
+        }
+
+        struct iovec iov[MAX_BATCH_IOV + 1];
+        int iovcnt = 0;
+        if (bf->buffer.size > 0) {
+            iov[iovcnt++] = (struct iovec){ bf->buffer.data, bf->buffer.size };
+        }
+        while (i < count && iovcnt < MAX_BATCH_IOV + 1) {
+            iov[iovcnt++] = pieces[i];
+            total += pieces[i].iov_len;
+            i++;
+        }
+
+        if (writev_all(bf->fd, iov, iovcnt) < 0) return -1;
+
+        bf->buffer.size = 0;
+        bf->buffer.position = 0;
+        bf->buffer.dirty = 0;
+    }
+
+    return total;
+}
+
+
+/*
+Asynchronous double buffering. The file owns two buffers of a configurable
+size: the caller copies into or out of one while the other is being filled
+(read mode) or drained (write mode) by an in-flight POSIX AIO request, which
+glibc services on a helper thread. I/O therefore overlaps with whatever the
+caller does between buffer_read/buffer_write calls instead of blocking on
+every refill or flush.
+*/
+typedef struct AsyncBufferedFile {
+    int fd;
+    int mode;               // O_RDONLY or O_WRONLY
+    size_t buffer_size;
+    char *buffers[2];
+    size_t size[2];         // bytes valid (read) or queued (write) in each buffer
+    int current;            // buffer the caller is working on
+    size_t position;        // read cursor inside the current buffer
+    off_t offset;           // file offset of the next request
+    struct aiocb cb;        // request on the other buffer
+    int in_flight;
+    int eof;
+} AsyncBufferedFile;
+
+
+// start a request on buffer `idx` at the current file offset
+static int async_submit(AsyncBufferedFile *af, int idx, size_t length) {
+    memset(&af->cb, 0, sizeof(af->cb));
+    af->cb.aio_fildes = af->fd;
+    af->cb.aio_buf = af->buffers[idx];
+    af->cb.aio_nbytes = length;
+    af->cb.aio_offset = af->offset;
+
+    int res = af->mode == O_RDONLY ? aio_read(&af->cb) : aio_write(&af->cb);
+    if (res < 0) return -1;
+
+    af->in_flight = 1;
+    return 0;
+}
+
+
+// wait for the in-flight request; returns its byte count or -1. A short
+// write is resubmitted for the remaining bytes (a short read just means EOF
+// or a partial fill, which the reader handles).
+static ssize_t async_wait(AsyncBufferedFile *af) {
+    if (!af->in_flight) return 0;
+
+    const struct aiocb *list[1] = { &af->cb };
+    ssize_t total = 0;
+
+    for (;;) {
+        while (aio_error(&af->cb) == EINPROGRESS) {
+            aio_suspend(list, 1, NULL);
+        }
+
+        af->in_flight = 0;
+        ssize_t bytes = aio_return(&af->cb);
+        if (bytes < 0) return -1;
+
+        af->offset += bytes;
+        total += bytes;
+        if (af->mode == O_RDONLY || (size_t)bytes == af->cb.aio_nbytes) return total;
+
+        if (bytes == 0) {
+            errno = EIO;    // no progress; give up rather than spin
+            return -1;
+        }
+
+        af->cb.aio_buf = (char*)af->cb.aio_buf + bytes;
+        af->cb.aio_nbytes -= bytes;
+        af->cb.aio_offset = af->offset;
+        if (aio_write(&af->cb) < 0) return -1;
+        af->in_flight = 1;
+    }
+}
+
+
+AsyncBufferedFile *create_async_buffered_file(int fd, int mode, size_t buffer_size) {
+    AsyncBufferedFile *af = calloc(1, sizeof(AsyncBufferedFile));
+    if (!af) return NULL;
+
+    af->fd = fd;
+    af->mode = mode;
+    af->buffer_size = buffer_size ? buffer_size : BUFFER_SIZE;
+    af->buffers[0] = malloc(af->buffer_size);
+    af->buffers[1] = malloc(af->buffer_size);
+    af->offset = lseek(fd, 0, SEEK_CUR);
+    if (af->offset < 0) af->offset = 0;
+
+    if (!af->buffers[0] || !af->buffers[1]) {
+        free(af->buffers[0]);
+        free(af->buffers[1]);
+        free(af);
+        return NULL;
+    }
+
+    // readers start prefetching right away
+    if (mode == O_RDONLY) {
+        af->current = 1;    // nothing to consume yet; first read swaps to buffer 0
+        async_submit(af, 0, af->buffer_size);
+    }
+
+    return af;
+}
+
+
+ssize_t async_buffer_read(AsyncBufferedFile *af, void *data, size_t count) {
+    if (!af || af->mode != O_RDONLY) return -1;
+
+    size_t total_read = 0;
+    char *dest = (char*)data;
+
+    while (total_read < count) {
+        // current buffer exhausted: take the prefetched one and queue the next
+        if (af->position >= af->size[af->current]) {
+            if (af->eof || !af->in_flight) break;
+
+            ssize_t bytes = async_wait(af);
+            if (bytes < 0) return total_read ? (ssize_t)total_read : -1;
+
+            af->current ^= 1;
+            af->size[af->current] = bytes;
+            af->position = 0;
+
+            if (bytes == 0) {
+                af->eof = 1;
+                break;
+            }
+            async_submit(af, af->current ^ 1, af->buffer_size);
+        }
+
+        size_t available = af->size[af->current] - af->position;
+        size_t to_copy = (count - total_read) < available ?
+                        (count - total_read) : available;
+
+        memcpy(dest + total_read,
+                af->buffers[af->current] + af->position,
+                to_copy);
+
+        af->position += to_copy;
+        total_read += to_copy;
+    }
+
+    return total_read;
+}
+
+
+// hand the current buffer to the background writer and switch to the other one
+static int async_drain_current(AsyncBufferedFile *af) {
+    if (af->size[af->current] == 0) return 0;
+
+    // the other buffer must be fully written before it is reused
+    if (async_wait(af) < 0) return -1;
+
+    if (async_submit(af, af->current, af->size[af->current]) < 0) return -1;
+
+    af->current ^= 1;
+    af->size[af->current] = 0;
+    return 0;
+}
+
+
+ssize_t async_buffer_write(AsyncBufferedFile *af, const void *data, size_t count) {
+    if (!af || af->mode == O_RDONLY) return -1;
+
+    size_t total_written = 0;
+    const char *src = (const char*)data;
+
+    while (total_written < count) {
+        if (af->size[af->current] >= af->buffer_size) {
+            if (async_drain_current(af) < 0) return -1;
+        }
+
+        size_t available = af->buffer_size - af->size[af->current];
+        size_t to_copy = (count - total_written) < available ?
+                        (count - total_written) : available;
+
+        memcpy(af->buffers[af->current] + af->size[af->current],
+                src + total_written,
+                to_copy);
+
+        af->size[af->current] += to_copy;
+        total_written += to_copy;
+    }
+
+    return total_written;
+}
+
+
+int async_buffer_flush(AsyncBufferedFile *af) {
+    if (!af || af->mode == O_RDONLY) return 0;
+
+    if (async_drain_current(af) < 0) return -1;
+    return async_wait(af) < 0 ? -1 : 0;
+}
+
+
+// flushes pending writes (or drops a pending prefetch) and frees the buffers
+int close_async_buffered_file(AsyncBufferedFile *af) {
+    if (!af) return 0;
+
+    int res = async_buffer_flush(af);
+    async_wait(af);
+
+    free(af->buffers[0]);
+    free(af->buffers[1]);
+    free(af);
+
+    return res;
+}
+
+
 int main() {
     // some code to call functions above
     BufferedFile *bf = create_buffered_file(1, 1);
+    buffer_write(bf, "Buffered hello\n", 15);
+    struct iovec parts[3] = {
+        { "Batched ", 8 }, { "writev ", 7 }, { "hello\n", 6 }
+    };
+    buffer_write_batch(bf, parts, 3);
+    buffer_flush(bf);
+    close_buffered_file(bf);
+
+    // write a file through the async writer, then read it back asynchronously
+    char path[] = "/tmp/buffering_demoXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+
+    AsyncBufferedFile *writer = create_async_buffered_file(fd, O_WRONLY, 64 * 1024);
+    char line[64];
+    long expected = 0;
+    for (int i = 0; i < 100000; ++i) {
+        int len = snprintf(line, sizeof(line), "log line %d\n", i);
+        async_buffer_write(writer, line, len);
+        expected += len;
+    }
+    close_async_buffered_file(writer);
+
+    lseek(fd, 0, SEEK_SET);
+    AsyncBufferedFile *reader = create_async_buffered_file(fd, O_RDONLY, 64 * 1024);
+    char chunk[1000];
+    long total = 0, lines = 0;
+    ssize_t n;
+    while ((n = async_buffer_read(reader, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            lines += chunk[i] == '\n';
+        }
+        total += n;
+    }
+    close_async_buffered_file(reader);
+
+    printf("Async round trip: wrote %ld bytes, read %ld bytes, %ld lines\n",
+           expected, total, lines);
+
+    // sequential scan through the mapping, without copying
+    BufferedFile *mapped = create_mapped_file(fd);
+    const char *view;
+    size_t len;
+    long mapped_lines = 0;
+    while ((view = buffer_read_view(mapped, 1 << 20, &len)) != NULL) {
+        for (size_t i = 0; i < len; ++i) {
+            mapped_lines += view[i] == '\n';
+        }
+    }
+    close_buffered_file(mapped);
+    printf("Mapped scan: %ld lines\n", mapped_lines);
+
+    // a large read bypasses the 4 KiB buffer
+    lseek(fd, 0, SEEK_SET);
+    BufferedFile *direct = create_buffered_file(fd, O_RDONLY);
+    char *bulk = malloc(expected);
+    printf("Bulk read: %zd bytes\n", buffer_read(direct, bulk, expected));
+    free(bulk);
+    close_buffered_file(direct);
+
+    close(fd);
+    unlink(path);
     
     return 0;
 }
@@ -2,9 +2,102 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #define MAX_PATH_LEN 256
-#define MAX_OPEN_FILES 128
+
+// Handle table: chunks of slots that are allocated on demand and never move
+#define HANDLE_INDEX_BITS 20
+#define HANDLE_CHUNK_SIZE 256
+#define HANDLE_MAX_CHUNKS ((1 << HANDLE_INDEX_BITS) / HANDLE_CHUNK_SIZE)
+#define HANDLE_GEN_MASK 0x7FF           // generation bits carried in a handle
+#define HANDLE_SHARDS 16                // free-index stacks, each with its own lock
+
+#define CACHE_PAGE_SIZE 4096
+#define CACHE_SHARDS 16
+#define CACHE_PAGES_PER_SHARD 256       // 16 shards * 256 pages * 4 KiB = 16 MiB
+#define READAHEAD_PAGES 8               // extra pages fetched by a sequential miss
+#define DIRTY_LIMIT (CACHE_SHARDS * CACHE_PAGES_PER_SHARD / 4)  // dirty pages before write-back
+
+
+/*
+Shared page cache. Pages are keyed by (device, inode, page index), so every
+handle on the same file shares them. The key hash picks one of CACHE_SHARDS
+shards, each with its own lock, hash table and ARC replacement state:
+T1 holds pages seen once recently, T2 pages seen at least twice, and the
+ghost lists B1/B2 remember keys recently evicted from T1/T2. A hit on a ghost
+moves the target size p of T1, so the cache adapts between recency and
+frequency without tuning (Megiddo & Modha, FAST '03).
+*/
+typedef enum { ARC_T1, ARC_T2, ARC_B1, ARC_B2, ARC_LIST_COUNT } ArcList;
+
+
+struct FileHandle;
+
+
+typedef struct CachePage {
+    dev_t dev;
+    ino_t ino;
+    off_t index;
+    ArcList list;
+    struct CachePage *prev;     // towards MRU
+    struct CachePage *next;     // towards LRU
+    struct CachePage *hash_next;
+    char *data;                 // NULL while the entry is a ghost
+    size_t valid;               // bytes of data holding file contents
+    int dirty;
+    int wb_fd;                  // descriptor the dirty page is written back through
+    struct FileHandle *wb_owner;    // handle that hears about a failed write-back
+} CachePage;
+
+
+typedef struct {
+    CachePage *head;    // MRU
+    CachePage *tail;    // LRU
+    size_t count;
+} ArcQueue;
+
+
+typedef struct CacheShard {
+    pthread_mutex_t lock;
+    CachePage *entries;
+    CachePage *free_entries;    // linked through next
+    char **free_buffers;
+    size_t free_buffer_count;
+    CachePage **buckets;
+    size_t bucket_mask;
+    ArcQueue lists[ARC_LIST_COUNT];
+    size_t capacity;            // resident pages
+    size_t target_t1;           // ARC's p
+    size_t dirty;
+    size_t hits;
+    size_t misses;
+    size_t readahead;
+    size_t writebacks;
+    size_t evictions;
+} CacheShard;
+
+
+typedef struct PageCache {
+    CacheShard shards[CACHE_SHARDS];
+    atomic_size_t dirty_pages;
+} PageCache;
+
+
+typedef struct CacheStats {
+    size_t hits;
+    size_t misses;
+    size_t readahead;
+    size_t writebacks;
+    size_t evictions;
+    size_t dirty;
+} CacheStats;
 
 
 typedef struct FileHandle {
@@ -12,119 +105,983 @@ typedef struct FileHandle {
     char path[MAX_PATH_LEN];
     off_t position;
     int flags;
+    dev_t dev;              // cache key of the file
+    ino_t ino;
+    off_t last_end;         // end offset of the previous read, for read-ahead
+    int wrote;              // handle has dirtied cache pages
+    atomic_int wb_error;    // errno of a write-back that failed, reported by fs_close
 } FileHandle;
 
 
+/*
+Open-file table. Slots live in fixed-size chunks reached through a chunk
+directory, so the table grows without moving slots that other threads are
+using. A handle is (generation << HANDLE_INDEX_BITS) | index; the slot's
+generation is odd while open and is bumped on both open and close, so a stale
+or double-closed handle fails validation without taking any lock. Closed
+indices go onto one of HANDLE_SHARDS free stacks (picked per thread), so
+concurrent opens and closes rarely meet on the same lock; an empty stack
+falls back to a never-used index from an atomic counter.
+*/
+typedef struct HandleSlot {
+    atomic_uint generation;
+    FileHandle file;
+} HandleSlot;
+
+
+typedef struct HandleShard {
+    pthread_mutex_t lock;
+    int *free_indices;
+    size_t count;
+    size_t capacity;
+} HandleShard;
+
+
+typedef struct HandleTable {
+    _Atomic(HandleSlot*) chunks[HANDLE_MAX_CHUNKS];
+    atomic_int next_index;
+    HandleShard shards[HANDLE_SHARDS];
+} HandleTable;
+
+
 typedef struct FileSystem {
-    FileHandle open_files[MAX_OPEN_FILES];
-    int file_count;
+    HandleTable handles;
+    atomic_int file_count;
     char mount_point[MAX_PATH_LEN];
+    PageCache *cache;
 } FileSystem;
 
 
+static int cache_shard_init(CacheShard *sh, size_t capacity) {
+    memset(sh, 0, sizeof(CacheShard));
+    pthread_mutex_init(&sh->lock, NULL);
+    sh->capacity = capacity;
+
+    // resident and ghost entries together never exceed 2 * capacity
+    sh->entries = calloc(2 * capacity, sizeof(CachePage));
+    sh->free_buffers = malloc(capacity * sizeof(char*));
+    size_t buckets = 1;
+    while (buckets < 4 * capacity) buckets <<= 1;
+    sh->buckets = calloc(buckets, sizeof(CachePage*));
+    sh->bucket_mask = buckets - 1;
+    if (!sh->entries || !sh->free_buffers || !sh->buckets) return -1;
+
+    for (size_t i = 0; i < 2 * capacity; ++i) {
+        sh->entries[i].next = sh->free_entries;
+        sh->free_entries = &sh->entries[i];
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        sh->free_buffers[i] = malloc(CACHE_PAGE_SIZE);
+        if (!sh->free_buffers[i]) return -1;
+        sh->free_buffer_count++;
+    }
+    return 0;
+}
+
+
+static void cache_shard_destroy(CacheShard *sh) {
+    for (size_t i = 0; i < 2 * sh->capacity; ++i) {
+        free(sh->entries[i].data);
+    }
+    for (size_t i = 0; i < sh->free_buffer_count; ++i) {
+        free(sh->free_buffers[i]);
+    }
+    free(sh->entries);
+    free(sh->free_buffers);
+    free(sh->buckets);
+    pthread_mutex_destroy(&sh->lock);
+}
+
+
+PageCache *cache_create() {
+    PageCache *cache = malloc(sizeof(PageCache));
+    if (!cache) return NULL;
+
+    for (int i = 0; i < CACHE_SHARDS; ++i) {
+        if (cache_shard_init(&cache->shards[i], CACHE_PAGES_PER_SHARD) < 0) {
+            return NULL;
+        }
+    }
+    atomic_init(&cache->dirty_pages, 0);
+    return cache;
+}
+
+
+static size_t page_hash(dev_t dev, ino_t ino, off_t index) {
+    uint64_t h = (uint64_t)dev * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)ino + 0x7F4A7C15ULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)index * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(h ^ (h >> 29));
+}
+
+
+static CacheShard *shard_for(PageCache *cache, dev_t dev, ino_t ino, off_t index) {
+    return &cache->shards[page_hash(dev, ino, index) % CACHE_SHARDS];
+}
+
+
+static CachePage **bucket_for(CacheShard *sh, dev_t dev, ino_t ino, off_t index) {
+    return &sh->buckets[(page_hash(dev, ino, index) / CACHE_SHARDS) & sh->bucket_mask];
+}
+
+
+// resident or ghost entry for the key, or NULL
+static CachePage *shard_lookup(CacheShard *sh, dev_t dev, ino_t ino, off_t index) {
+    for (CachePage *pg = *bucket_for(sh, dev, ino, index); pg; pg = pg->hash_next) {
+        if (pg->dev == dev && pg->ino == ino && pg->index == index) return pg;
+    }
+    return NULL;
+}
+
+
+static void queue_remove(CacheShard *sh, CachePage *pg) {
+    ArcQueue *q = &sh->lists[pg->list];
+    if (pg->prev) pg->prev->next = pg->next; else q->head = pg->next;
+    if (pg->next) pg->next->prev = pg->prev; else q->tail = pg->prev;
+    q->count--;
+}
+
+
+static void queue_push_mru(CacheShard *sh, CachePage *pg, ArcList list) {
+    ArcQueue *q = &sh->lists[list];
+    pg->list = list;
+    pg->prev = NULL;
+    pg->next = q->head;
+    if (q->head) q->head->prev = pg; else q->tail = pg;
+    q->head = pg;
+    q->count++;
+}
+
+
+static void page_clean(PageCache *cache, CacheShard *sh, CachePage *pg) {
+    pg->dirty = 0;
+    sh->dirty--;
+    atomic_fetch_sub(&cache->dirty_pages, 1);
+}
+
+
+// on failure the page stays dirty and the error is left on the owning handle
+static int page_writeback(PageCache *cache, CacheShard *sh, CachePage *pg) {
+    if (!pg->dirty) return 0;
+
+    size_t done = 0;
+    while (done < pg->valid) {
+        ssize_t n = pwrite(pg->wb_fd, pg->data + done, pg->valid - done,
+                           pg->index * CACHE_PAGE_SIZE + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            atomic_store(&pg->wb_owner->wb_error, errno);
+            return -1;
+        }
+        done += n;
+    }
+
+    page_clean(cache, sh, pg);
+    sh->writebacks++;
+    return 0;
+}
+
+
+/*
+Write back if needed and give the page's buffer up, turning it into a ghost.
+The buffer is needed now, so a page whose write-back fails is dropped; the
+error stays on its handle and comes back from fs_close, as the kernel
+reports write-back errors at fsync/close.
+*/
+static void page_evict(PageCache *cache, CacheShard *sh, CachePage *pg) {
+    if (page_writeback(cache, sh, pg) < 0) {
+        page_clean(cache, sh, pg);
+    }
+    sh->free_buffers[sh->free_buffer_count++] = pg->data;
+    pg->data = NULL;
+    pg->valid = 0;
+    sh->evictions++;
+}
+
+
+// drop a ghost entry entirely
+static void ghost_delete(CacheShard *sh, CachePage *pg) {
+    queue_remove(sh, pg);
+
+    CachePage **link = bucket_for(sh, pg->dev, pg->ino, pg->index);
+    while (*link != pg) link = &(*link)->hash_next;
+    *link = pg->hash_next;
+
+    pg->next = sh->free_entries;
+    sh->free_entries = pg;
+}
+
+
+// ARC REPLACE: evict the LRU of T1 or T2 into its ghost list
+static void arc_replace(PageCache *cache, CacheShard *sh, int hit_in_b2) {
+    ArcQueue *t1 = &sh->lists[ARC_T1];
+    CachePage *victim;
+
+    // T2 can be empty when truncation has thinned the shard out
+    if (t1->count > 0 &&
+        (t1->count > sh->target_t1 || (hit_in_b2 && t1->count == sh->target_t1) ||
+         sh->lists[ARC_T2].count == 0)) {
+        victim = t1->tail;
+        queue_remove(sh, victim);
+        page_evict(cache, sh, victim);
+        queue_push_mru(sh, victim, ARC_B1);
+    }
+    else {
+        victim = sh->lists[ARC_T2].tail;
+        queue_remove(sh, victim);
+        page_evict(cache, sh, victim);
+        queue_push_mru(sh, victim, ARC_B2);
+    }
+}
+
+
+// make the key resident (it must not be resident yet); returns the page with
+// an empty buffer, placed according to the ARC cases for a miss
+static CachePage *arc_admit(PageCache *cache, CacheShard *sh, dev_t dev, ino_t ino, off_t index) {
+    size_t c = sh->capacity;
+    size_t t1 = sh->lists[ARC_T1].count, t2 = sh->lists[ARC_T2].count;
+    size_t b1 = sh->lists[ARC_B1].count, b2 = sh->lists[ARC_B2].count;
+    CachePage *pg = shard_lookup(sh, dev, ino, index);
+
+    if (pg && pg->list == ARC_B1) {
+        // recency is paying off: grow T1's target
+        size_t delta = b2 > b1 ? b2 / b1 : 1;
+        sh->target_t1 = sh->target_t1 + delta < c ? sh->target_t1 + delta : c;
+        if (sh->free_buffer_count == 0) arc_replace(cache, sh, 0);
+        queue_remove(sh, pg);
+        queue_push_mru(sh, pg, ARC_T2);
+    }
+    else if (pg && pg->list == ARC_B2) {
+        // frequency is paying off: shrink T1's target
+        size_t delta = b1 > b2 ? b1 / b2 : 1;
+        sh->target_t1 = sh->target_t1 > delta ? sh->target_t1 - delta : 0;
+        if (sh->free_buffer_count == 0) arc_replace(cache, sh, 1);
+        queue_remove(sh, pg);
+        queue_push_mru(sh, pg, ARC_T2);
+    }
+    else {
+        if (t1 + b1 == c) {
+            if (t1 < c) {
+                ghost_delete(sh, sh->lists[ARC_B1].tail);
+                if (sh->free_buffer_count == 0) arc_replace(cache, sh, 0);
+            }
+            else {
+                CachePage *victim = sh->lists[ARC_T1].tail;
+                queue_remove(sh, victim);
+                page_evict(cache, sh, victim);
+                queue_push_mru(sh, victim, ARC_B1);
+                ghost_delete(sh, victim);
+            }
+        }
+        else if (t1 + t2 + b1 + b2 >= c) {
+            if (t1 + t2 + b1 + b2 == 2 * c) {
+                ghost_delete(sh, sh->lists[ARC_B2].tail);
+            }
+            if (sh->free_buffer_count == 0) arc_replace(cache, sh, 0);
+        }
+
+        pg = sh->free_entries;
+        sh->free_entries = pg->next;
+        pg->dev = dev;
+        pg->ino = ino;
+        pg->index = index;
+        pg->dirty = 0;
+
+        CachePage **bucket = bucket_for(sh, dev, ino, index);
+        pg->hash_next = *bucket;
+        *bucket = pg;
+        queue_push_mru(sh, pg, ARC_T1);
+    }
+
+    pg->data = sh->free_buffers[--sh->free_buffer_count];
+    pg->valid = 0;
+    return pg;
+}
+
+
+// resident page for the key, or NULL; a hit moves it to T2's MRU end
+static CachePage *cache_hit(CacheShard *sh, dev_t dev, ino_t ino, off_t index) {
+    CachePage *pg = shard_lookup(sh, dev, ino, index);
+    if (!pg || (pg->list != ARC_T1 && pg->list != ARC_T2)) return NULL;
+
+    queue_remove(sh, pg);
+    queue_push_mru(sh, pg, ARC_T2);
+    return pg;
+}
+
+
+// install fetched contents for a page unless it is already resident
+static void cache_install(PageCache *cache, dev_t dev, ino_t ino, off_t index,
+                          const char *data, size_t valid) {
+    CacheShard *sh = shard_for(cache, dev, ino, index);
+
+    pthread_mutex_lock(&sh->lock);
+    CachePage *pg = shard_lookup(sh, dev, ino, index);
+    if (!pg || pg->list == ARC_B1 || pg->list == ARC_B2) {
+        pg = arc_admit(cache, sh, dev, ino, index);
+        memcpy(pg->data, data, valid);
+        pg->valid = valid;
+        sh->readahead++;
+    }
+    pthread_mutex_unlock(&sh->lock);
+}
+
+
+// write back every dirty page (only those written through `fd` if fd >= 0);
+// -1 if any failed, those stay dirty
+int cache_writeback(PageCache *cache, int fd) {
+    int res = 0;
+
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+
+        pthread_mutex_lock(&sh->lock);
+        for (int l = ARC_T1; l <= ARC_T2; ++l) {
+            for (CachePage *pg = sh->lists[l].head; pg && sh->dirty; pg = pg->next) {
+                if (pg->dirty && (fd < 0 || pg->wb_fd == fd)) {
+                    if (page_writeback(cache, sh, pg) < 0) res = -1;
+                }
+            }
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+    return res;
+}
+
+
+// write back the dirty pages of one file, whichever handle wrote them
+static int cache_writeback_inode(PageCache *cache, dev_t dev, ino_t ino) {
+    int res = 0;
+
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+
+        pthread_mutex_lock(&sh->lock);
+        for (int l = ARC_T1; l <= ARC_T2; ++l) {
+            for (CachePage *pg = sh->lists[l].head; pg && sh->dirty; pg = pg->next) {
+                if (pg->dirty && pg->dev == dev && pg->ino == ino) {
+                    if (page_writeback(cache, sh, pg) < 0) res = -1;
+                }
+            }
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+    return res;
+}
+
+
+// forget dirty pages written through `fd` without writing them
+static void cache_discard_dirty(PageCache *cache, int fd) {
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+
+        pthread_mutex_lock(&sh->lock);
+        for (int l = ARC_T1; l <= ARC_T2; ++l) {
+            for (CachePage *pg = sh->lists[l].head; pg && sh->dirty; pg = pg->next) {
+                if (pg->dirty && pg->wb_fd == fd) page_clean(cache, sh, pg);
+            }
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+
+// drop the file's pages from `first_index` on, dirty or not, ghosts included
+// (truncate); removing entries keeps the ARC bounds on T1+B1 and the total
+static void cache_drop_from(PageCache *cache, dev_t dev, ino_t ino, off_t first_index) {
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+
+        pthread_mutex_lock(&sh->lock);
+        for (int l = ARC_T1; l < ARC_LIST_COUNT; ++l) {
+            CachePage *pg = sh->lists[l].head;
+            while (pg) {
+                CachePage *next = pg->next;
+                if (pg->dev == dev && pg->ino == ino && pg->index >= first_index) {
+                    if (pg->dirty) page_clean(cache, sh, pg);
+                    if (pg->data) {
+                        sh->free_buffers[sh->free_buffer_count++] = pg->data;
+                        pg->data = NULL;
+                        pg->valid = 0;
+                    }
+                    ghost_delete(sh, pg);
+                }
+                pg = next;
+            }
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+
+CacheStats cache_stats(PageCache *cache) {
+    CacheStats stats = {0};
+
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+
+        pthread_mutex_lock(&sh->lock);
+        stats.hits += sh->hits;
+        stats.misses += sh->misses;
+        stats.readahead += sh->readahead;
+        stats.writebacks += sh->writebacks;
+        stats.evictions += sh->evictions;
+        stats.dirty += sh->dirty;
+        pthread_mutex_unlock(&sh->lock);
+    }
+    return stats;
+}
+
+
+void cache_destroy(PageCache *cache) {
+    if (!cache) return;
+
+    cache_writeback(cache, -1);
+    for (int i = 0; i < CACHE_SHARDS; ++i) {
+        cache_shard_destroy(&cache->shards[i]);
+    }
+    free(cache);
+}
+
+
+static atomic_int next_thread_shard = 0;
+static __thread int thread_shard = -1;
+
+
+static HandleSlot *handle_slot(HandleTable *table, int index) {
+    HandleSlot *chunk = atomic_load_explicit(&table->chunks[index / HANDLE_CHUNK_SIZE],
+                                             memory_order_acquire);
+    return chunk ? &chunk[index % HANDLE_CHUNK_SIZE] : NULL;
+}
+
+
+// reserve an index: reuse one from this thread's shard, else take a new one
+static int handle_acquire(HandleTable *table) {
+    if (thread_shard < 0) {
+        thread_shard = atomic_fetch_add(&next_thread_shard, 1) % HANDLE_SHARDS;
+    }
+
+    HandleShard *shard = &table->shards[thread_shard];
+    int index = -1;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->count > 0) {
+        index = shard->free_indices[--shard->count];
+    }
+    pthread_mutex_unlock(&shard->lock);
+    if (index >= 0) return index;
+
+    index = atomic_fetch_add(&table->next_index, 1);
+    if (index >= (1 << HANDLE_INDEX_BITS)) {
+        atomic_fetch_sub(&table->next_index, 1);
+        return -1;
+    }
+
+    // first index of a chunk may need the chunk itself; losers of the race free theirs
+    _Atomic(HandleSlot*) *chunk = &table->chunks[index / HANDLE_CHUNK_SIZE];
+    if (atomic_load_explicit(chunk, memory_order_acquire) == NULL) {
+        HandleSlot *fresh = calloc(HANDLE_CHUNK_SIZE, sizeof(HandleSlot));
+        HandleSlot *expected = NULL;
+        if (!fresh) return -1;
+        if (!atomic_compare_exchange_strong(chunk, &expected, fresh)) {
+            free(fresh);
+        }
+    }
+    return index;
+}
+
+
+static void handle_release(HandleTable *table, int index) {
+    if (thread_shard < 0) {
+        thread_shard = atomic_fetch_add(&next_thread_shard, 1) % HANDLE_SHARDS;
+    }
+
+    HandleShard *shard = &table->shards[thread_shard];
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->count == shard->capacity) {
+        size_t capacity = shard->capacity ? shard->capacity * 2 : 64;
+        int *grown = realloc(shard->free_indices, capacity * sizeof(int));
+        if (!grown) {
+            pthread_mutex_unlock(&shard->lock);
+            return;     // index leaks; the table still works
+        }
+        shard->free_indices = grown;
+        shard->capacity = capacity;
+    }
+    shard->free_indices[shard->count++] = index;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+
+// open file for a handle, or NULL (errno = EBADF) if it is not currently valid
+static FileHandle *handle_lookup(FileSystem *fs, int handle) {
+    if (handle < 0) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    int index = handle & ((1 << HANDLE_INDEX_BITS) - 1);
+    unsigned gen = (unsigned)handle >> HANDLE_INDEX_BITS;
+    HandleSlot *slot = index < atomic_load(&fs->handles.next_index) ?
+                       handle_slot(&fs->handles, index) : NULL;
+
+    if (!slot) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    unsigned curr = atomic_load_explicit(&slot->generation, memory_order_acquire);
+    if (!(curr & 1) || (curr & HANDLE_GEN_MASK) != gen) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &slot->file;
+}
+
+
 FileSystem *fs_init(const char *mount_point) {
     FileSystem *fs = malloc(sizeof(FileSystem));
     if (!fs) return NULL;
 
     memset(fs, 0, sizeof(FileSystem));
     strncpy(fs->mount_point, mount_point, MAX_PATH_LEN - 1);
-    fs->file_count = 0;
+    atomic_init(&fs->file_count, 0);
+    atomic_init(&fs->handles.next_index, 0);
+    for (int i = 0; i < HANDLE_SHARDS; ++i) {
+        pthread_mutex_init(&fs->handles.shards[i].lock, NULL);
+    }
+
+    fs->cache = cache_create();
+    if (!fs->cache) {
+        free(fs);
+        return NULL;
+    }
 
     return fs;
 }
 
 
 int fs_open(FileSystem *fs, const char *path, int flags) {
-    if (fs->file_count >= MAX_OPEN_FILES) {
-        errno = EMFILE;
+    // open the actual file
+    char full_path[MAX_PATH_LEN];
+    snprintf(full_path, MAX_PATH_LEN, "%s/%s", fs->mount_point, path);
+
+    // O_APPEND is handled by fs_write: on Linux a pwrite through an O_APPEND
+    // descriptor ignores its offset, which would break page write-back
+    int fd = open(full_path, flags & ~O_APPEND, 0644);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
         return -1;
     }
 
-    // find free handle
-    int handle = -1;
-    for (int i = 0; i < MAX_OPEN_FILES; ++i) {
-        if (fs->open_files[i].fd == 0) {
-            handle = i;
-            break;
-        }
+    // get a free handle in O(1)
+    int index = handle_acquire(&fs->handles);
+    if (index < 0) {
+        close(fd);
+        errno = EMFILE;
+        return -1;
     }
 
-    if (handle == -1) {
-        errno = EMFILE;
+    HandleSlot *slot = handle_slot(&fs->handles, index);
+    if (!slot) {
+        close(fd);
+        errno = ENOMEM;
         return -1;
     }
 
-    // open the actual file
-    char full_path[MAX_PATH_LEN];
-    snprintf(full_path, MAX_PATH_LEN, "%s/%s", fs->mount_point, path);
+    FileHandle *fh = &slot->file;
+    memset(fh, 0, sizeof(FileHandle));
+    fh->fd = fd;
+    fh->dev = st.st_dev;
+    fh->ino = st.st_ino;
+    fh->last_end = -1;
+    fh->wrote = 0;
+    strncpy(fh->path, path, MAX_PATH_LEN - 1);
+    fh->position = 0;
+    fh->flags = flags;
+    atomic_init(&fh->wb_error, 0);
 
-    int fd = open(full_path, flags);
-    if (fd < 0) return -1;
+    // the file is empty now, whatever the cache remembers of it
+    if (flags & O_TRUNC) {
+        cache_drop_from(fs->cache, fh->dev, fh->ino, 0);
+    }
 
-    fs->open_files[handle].fd = fd;
-    strncpy(fs->open_files[handle].path, path, MAX_PATH_LEN - 1);
-    fs->open_files[handle].position = 0;
-    fs->open_files[handle].flags = flags;
-    fs->file_count++;
+    // publish: the generation turns odd once the slot is fully set up
+    unsigned gen = atomic_fetch_add_explicit(&slot->generation, 1, memory_order_release) + 1;
+    atomic_fetch_add(&fs->file_count, 1);
 
-    return handle;
+    return (int)((gen & HANDLE_GEN_MASK) << HANDLE_INDEX_BITS) | index;
 }
 
 
-// read from file
+// read from file, through the page cache
 ssize_t fs_read(FileSystem *fs, int handle, void *buffer, size_t size) {
-    if (handle < 0 || handle >= MAX_OPEN_FILES || fs->open_files[handle].fd == 0) {
+    FileHandle *fh = handle_lookup(fs, handle);
+    if (!fh) return -1;
+
+    if ((fh->flags & O_ACCMODE) == O_WRONLY) {
         errno = EBADF;
         return -1;
     }
 
-    ssize_t bytes = read(fs->open_files[handle].fd, buffer, size);
-    if (bytes > 0) {
-        fs->open_files[handle].position += bytes;
+    PageCache *cache = fs->cache;
+    char *dest = (char*)buffer;
+    size_t total = 0;
+    int sequential = fh->position == fh->last_end || fh->position == 0;
+
+    while (total < size) {
+        off_t pos = fh->position + total;
+        off_t index = pos / CACHE_PAGE_SIZE;
+        size_t in_page = pos % CACHE_PAGE_SIZE;
+        size_t want = size - total;
+        size_t copied = 0;
+        int at_eof = 0;
+
+        CacheShard *sh = shard_for(cache, fh->dev, fh->ino, index);
+        pthread_mutex_lock(&sh->lock);
+        CachePage *pg = cache_hit(sh, fh->dev, fh->ino, index);
+        if (pg) {
+            sh->hits++;
+            if (in_page < pg->valid) {
+                copied = pg->valid - in_page < want ? pg->valid - in_page : want;
+                memcpy(dest + total, pg->data + in_page, copied);
+            }
+            at_eof = pg->valid < CACHE_PAGE_SIZE && in_page + copied >= pg->valid;
+        }
+        else {
+            sh->misses++;
+        }
+        pthread_mutex_unlock(&sh->lock);
+
+        if (!pg) {
+            // miss: one pread for this page plus the read-ahead window
+            size_t pages = sequential ? 1 + READAHEAD_PAGES : 1;
+            char *fetch = malloc(pages * CACHE_PAGE_SIZE);
+            if (!fetch) return total ? (ssize_t)total : -1;
+
+            ssize_t bytes = pread(fh->fd, fetch, pages * CACHE_PAGE_SIZE, index * CACHE_PAGE_SIZE);
+            if (bytes < 0) {
+                free(fetch);
+                return total ? (ssize_t)total : -1;
+            }
+
+            for (size_t p = 0; p < pages && (p == 0 || (ssize_t)(p * CACHE_PAGE_SIZE) < bytes); ++p) {
+                ssize_t left = bytes - (ssize_t)(p * CACHE_PAGE_SIZE);
+                size_t valid = left <= 0 ? 0 : (left > CACHE_PAGE_SIZE ? CACHE_PAGE_SIZE : (size_t)left);
+                cache_install(cache, fh->dev, fh->ino, index + p, fetch + p * CACHE_PAGE_SIZE, valid);
+            }
+            free(fetch);
+            continue;   // serve from the cache, which may hold newer dirty data
+        }
+
+        total += copied;
+        if (at_eof || copied == 0) break;
     }
 
-    return bytes;
+    fh->position += total;
+    fh->last_end = fh->position;
+    return total;
 }
 
 
-// write to file
+// write to file: data lands in cached pages and is written back later
 ssize_t fs_write(FileSystem *fs, int handle, const void *buffer, size_t size) {
-    if (handle < 0 || handle >= MAX_OPEN_FILES || fs->open_files[handle].fd == 0) {
+    FileHandle *fh = handle_lookup(fs, handle);
+    if (!fh) return -1;
+
+    if ((fh->flags & O_ACCMODE) == O_RDONLY) {
         errno = EBADF;
         return -1;
     }
 
-    ssize_t bytes = write(fs->open_files[handle].fd, buffer, size);
-    if (bytes > 0) {
-        fs->open_files[handle].position += bytes;
+    PageCache *cache = fs->cache;
+
+    // O_APPEND: flush the file's dirty pages so its size on disk is current, then write at the end
+    if (fh->flags & O_APPEND) {
+        struct stat st;
+        if (cache_writeback_inode(cache, fh->dev, fh->ino) < 0 || fstat(fh->fd, &st) < 0) {
+            return -1;
+        }
+        fh->position = st.st_size;
+    }
+
+    const char *src = (const char*)buffer;
+    size_t total = 0;
+
+    while (total < size) {
+        off_t pos = fh->position + total;
+        off_t index = pos / CACHE_PAGE_SIZE;
+        size_t in_page = pos % CACHE_PAGE_SIZE;
+        size_t chunk = CACHE_PAGE_SIZE - in_page < size - total ?
+                       CACHE_PAGE_SIZE - in_page : size - total;
+        int full_page = (in_page == 0 && chunk == CACHE_PAGE_SIZE);
+
+        CacheShard *sh = shard_for(cache, fh->dev, fh->ino, index);
+        pthread_mutex_lock(&sh->lock);
+        CachePage *pg = cache_hit(sh, fh->dev, fh->ino, index);
+
+        if (!pg && !full_page) {
+            // partial write to an uncached page: fetch the old contents first
+            pthread_mutex_unlock(&sh->lock);
+
+            char page[CACHE_PAGE_SIZE];
+            ssize_t bytes = pread(fh->fd, page, CACHE_PAGE_SIZE, index * CACHE_PAGE_SIZE);
+            if (bytes < 0) {
+                // cannot read the file (e.g. O_WRONLY): write through instead
+                ssize_t written = pwrite(fh->fd, src + total, chunk, pos);
+                if (written < 0) return total ? (ssize_t)total : -1;
+                total += written;
+                continue;
+            }
+            cache_install(cache, fh->dev, fh->ino, index, page, bytes);
+
+            pthread_mutex_lock(&sh->lock);
+            pg = cache_hit(sh, fh->dev, fh->ino, index);
+            if (!pg) {      // evicted again already; retry
+                pthread_mutex_unlock(&sh->lock);
+                continue;
+            }
+        }
+        else if (!pg) {
+            pg = arc_admit(cache, sh, fh->dev, fh->ino, index);
+        }
+
+        memcpy(pg->data + in_page, src + total, chunk);
+        if (in_page + chunk > pg->valid) pg->valid = in_page + chunk;
+        pg->wb_fd = fh->fd;
+        pg->wb_owner = fh;
+        if (!pg->dirty) {
+            pg->dirty = 1;
+            sh->dirty++;
+            atomic_fetch_add(&cache->dirty_pages, 1);
+        }
+        pthread_mutex_unlock(&sh->lock);
+
+        total += chunk;
+    }
+
+    fh->position += total;
+    fh->wrote = 1;
+
+    if (atomic_load(&cache->dirty_pages) > DIRTY_LIMIT) {
+        cache_writeback(cache, -1);
     }
 
-    return bytes;
+    return total;
 }
 
 
 // close file
 int fs_close(FileSystem *fs, int handle) {
-    if (handle < 0 || handle >= MAX_OPEN_FILES || fs->open_files[handle].fd == 0) {
+    FileHandle *fh = handle_lookup(fs, handle);
+    if (!fh) return -1;
+
+    // retire the handle first: the generation turns even, so a racing second
+    // close of the same handle fails the compare-exchange and gets EBADF
+    int index = handle & ((1 << HANDLE_INDEX_BITS) - 1);
+    HandleSlot *slot = handle_slot(&fs->handles, index);
+    unsigned gen = atomic_load(&slot->generation);
+    if (!(gen & 1) || !atomic_compare_exchange_strong(&slot->generation, &gen, gen + 1)) {
+        errno = EBADF;
+        return -1;
+    }
+
+    // dirty pages must go out through this descriptor before it closes; any
+    // that cannot are dropped and the error is returned
+    if (fh->wrote && cache_writeback(fs->cache, fh->fd) < 0) {
+        cache_discard_dirty(fs->cache, fh->fd);
+    }
+    int wb_error = atomic_load(&fh->wb_error);
+
+    int res = close(fh->fd);
+    if (wb_error) {
+        errno = wb_error;
+        res = -1;
+    }
+    memset(fh, 0, sizeof(FileHandle)); // clears the structure
+    atomic_fetch_sub(&fs->file_count, 1);
+    handle_release(&fs->handles, index);
+
+    return res;
+}
+
+
+// resize the file; cached pages past the new end are dropped
+int fs_truncate(FileSystem *fs, int handle, off_t size) {
+    FileHandle *fh = handle_lookup(fs, handle);
+    if (!fh) return -1;
+
+    if ((fh->flags & O_ACCMODE) == O_RDONLY) {
         errno = EBADF;
         return -1;
     }
 
-    int res = close(fs->open_files[handle].fd);
-    if (res == 0) {
-        memset(&fs->open_files[handle], 0, sizeof(FileHandle)); // clears the structure
-        fs->file_count--;
+    // the page holding the new end must reach the disk before it is cut
+    struct stat st;
+    if (cache_writeback_inode(fs->cache, fh->dev, fh->ino) < 0) return -1;
+    if (fstat(fh->fd, &st) < 0) return -1;
+    if (ftruncate(fh->fd, size) < 0) return -1;
+
+    // growing leaves the old last page short, so it goes too
+    off_t end = st.st_size < size ? st.st_size : size;
+    cache_drop_from(fs->cache, fh->dev, fh->ino, end / CACHE_PAGE_SIZE);
+    return 0;
+}
+
+
+void fs_destroy(FileSystem *fs) {
+    cache_destroy(fs->cache);
+    for (int i = 0; i < HANDLE_MAX_CHUNKS; ++i) {
+        free(atomic_load(&fs->handles.chunks[i]));
+    }
+    for (int i = 0; i < HANDLE_SHARDS; ++i) {
+        free(fs->handles.shards[i].free_indices);
+        pthread_mutex_destroy(&fs->handles.shards[i].lock);
+    }
+    free(fs);
+}
+
+
+// truncating files whose pages sit in the ghost lists, then missing, must
+// keep every shard's ARC invariants (and must not crash in arc_replace)
+static int check_truncate_then_miss(void) {
+    PageCache *cache = cache_create();
+    if (!cache) return -1;
+
+    char page[CACHE_PAGE_SIZE] = {0};
+    off_t pages = CACHE_SHARDS * CACHE_PAGES_PER_SHARD;
+
+    // file 1 read twice lands in T2; a scan of file 2 pushes it into B2
+    for (off_t i = 0; i < pages; ++i) cache_install(cache, 0, 1, i, page, sizeof(page));
+    for (off_t i = 0; i < pages; ++i) {
+        CacheShard *sh = shard_for(cache, 0, 1, i);
+        pthread_mutex_lock(&sh->lock);
+        cache_hit(sh, 0, 1, i);
+        pthread_mutex_unlock(&sh->lock);
+    }
+    for (off_t i = 0; i < pages; ++i) cache_install(cache, 0, 2, i, page, sizeof(page));
+
+    // a hit on a B2 ghost, then both files truncated away
+    for (off_t i = 0; i < pages / 8; ++i) cache_install(cache, 0, 1, i, page, sizeof(page));
+    cache_drop_from(cache, 0, 1, 0);
+    cache_drop_from(cache, 0, 2, 0);
+
+    for (off_t i = 0; i < pages; ++i) cache_install(cache, 0, 3, i, page, sizeof(page));
+
+    int res = 0;
+    for (int s = 0; s < CACHE_SHARDS; ++s) {
+        CacheShard *sh = &cache->shards[s];
+        size_t t1 = sh->lists[ARC_T1].count, t2 = sh->lists[ARC_T2].count;
+        size_t b1 = sh->lists[ARC_B1].count, b2 = sh->lists[ARC_B2].count;
+        if (t1 + t2 + sh->free_buffer_count != sh->capacity || t1 + b1 > sh->capacity ||
+            t1 + t2 + b1 + b2 > 2 * sh->capacity) {
+            res = -1;
+        }
     }
 
+    cache_destroy(cache);
     return res;
 }
 
 
+// concurrent open/read/close throughput
+#define BENCH_ITERATIONS 20000
+
+typedef struct {
+    FileSystem *fs;
+    const char *path;
+} BenchArg;
+
+
+static void *open_read_close_worker(void *arg) {
+    BenchArg *b = (BenchArg*)arg;
+    char buffer[CACHE_PAGE_SIZE];
+
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        int handle = fs_open(b->fs, b->path, O_RDONLY);
+        if (handle < 0) continue;
+        fs_read(b->fs, handle, buffer, sizeof(buffer));
+        fs_close(b->fs, handle);
+    }
+    return NULL;
+}
+
+
+void benchmark_handles(FileSystem *fs, const char *path) {
+    printf("\nOpen/read/close throughput (ops/sec):\n");
+
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        pthread_t workers[threads];
+        BenchArg arg = { fs, path };
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < threads; ++i) {
+            pthread_create(&workers[i], NULL, open_read_close_worker, &arg);
+        }
+        for (int i = 0; i < threads; ++i) {
+            pthread_join(workers[i], NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%d threads: %.0f\n", threads, threads * BENCH_ITERATIONS / secs);
+    }
+}
+
+
 int main() {
     // some code to call functions above
-    const char *mount_point = "./";
+    const char *mount_point = "/tmp";
     FileSystem *fs = fs_init(mount_point);
-    
+    if (!fs) return 1;
+
+    // write a file through the cache, then read it from two handles
+    int out = fs_open(fs, "fs_cache_demo.txt", O_CREAT | O_RDWR | O_TRUNC);
+    char line[64];
+    for (int i = 0; i < 20000; ++i) {
+        int len = snprintf(line, sizeof(line), "config entry %d\n", i);
+        fs_write(fs, out, line, len);
+    }
+    fs_close(fs, out);
+
+    char chunk[1024];
+    for (int pass = 0; pass < 2; ++pass) {
+        int in = fs_open(fs, "fs_cache_demo.txt", O_RDONLY);
+        ssize_t n, total = 0;
+        while ((n = fs_read(fs, in, chunk, sizeof(chunk))) > 0) {
+            total += n;
+        }
+        fs_close(fs, in);
+        printf("Pass %d read %zd bytes\n", pass + 1, total);
+    }
+
+    CacheStats stats = cache_stats(fs->cache);
+    printf("Page cache: %zu hits, %zu misses, %zu read-ahead/fill pages, "
+           "%zu write-backs, %zu evictions\n",
+           stats.hits, stats.misses, stats.readahead, stats.writebacks, stats.evictions);
+
+    // truncate: shrink then grow past a cached short page
+    out = fs_open(fs, "fs_cache_demo.txt", O_RDWR | O_TRUNC);
+    fs_write(fs, out, "hello", 5);
+    fs_truncate(fs, out, 10000);
+    fs_close(fs, out);
+    int in = fs_open(fs, "fs_cache_demo.txt", O_RDONLY);
+    ssize_t n, grown = 0;
+    while ((n = fs_read(fs, in, chunk, sizeof(chunk))) > 0) grown += n;
+    fs_close(fs, in);
+    printf("Grown by truncate: read %zd of 10000 bytes\n", grown);
+    printf("Truncate then miss: %s\n", check_truncate_then_miss() == 0 ? "ARC invariants hold" : "BROKEN");
+
+    benchmark_handles(fs, "fs_cache_demo.txt");
+
+    unlink("/tmp/fs_cache_demo.txt");
+    fs_destroy(fs);
 
     return 0;
 }
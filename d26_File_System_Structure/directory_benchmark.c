@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "directory_organization.c"
+
+#define BENCH_ENTRIES 200000
+
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+static int compare_entry_ptrs(const void *a, const void *b) {
+    return strcmp((*(DirectoryEntry* const*)a)->name, (*(DirectoryEntry* const*)b)->name);
+}
+
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const DirectoryEntry*)a)->name, ((const DirectoryEntry*)b)->name);
+}
+
+
+// sorted readdir for the unordered indexes: gather pointers, then sort them
+static size_t sorted_listing(DirectoryEntry **out, DirectoryEntry **found, size_t count) {
+    memcpy(out, found, count * sizeof(DirectoryEntry*));
+    qsort(out, count, sizeof(DirectoryEntry*), compare_entry_ptrs);
+    return count;
+}
+
+
+typedef struct ListingCheck {
+    const char *prev;
+    size_t out_of_order;
+} ListingCheck;
+
+
+static void check_order(DirectoryEntry *entry, void *arg) {
+    ListingCheck *check = arg;
+    if (check->prev && strcmp(check->prev, entry->name) >= 0) check->out_of_order++;
+    check->prev = entry->name;
+}
+
+
+int main() {
+    // names look like a mail spool: shared prefixes, random order
+    DirectoryEntry *names = calloc(BENCH_ENTRIES, sizeof(DirectoryEntry));
+    DirectoryEntry **listing = malloc(BENCH_ENTRIES * sizeof(DirectoryEntry*));
+    DirectoryEntry **found = malloc(BENCH_ENTRIES * sizeof(DirectoryEntry*));
+    if (!names || !listing || !found) return 1;
+
+    srand(7);
+    for (int i = 0; i < BENCH_ENTRIES; i++) {
+        snprintf(names[i].name, MAX_NAME_LEN, "msg-%08x-%06d.eml", (unsigned)rand(), i);
+        names[i].type = ENTRY_TYPE_FILE;
+    }
+
+    struct timespec start, end;
+    printf("%d entries        insert ms   lookup ms   sorted listing ms\n", BENCH_ENTRIES);
+
+    // Directory: the hash-indexed entry array
+    Directory *linear = init_directory("/bench");
+    if (!linear) return 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ENTRIES; i++) add_directory_entry(linear, names[i].name, ENTRY_TYPE_FILE);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double insert_ms = elapsed_ms(&start, &end);
+
+    size_t misses = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = BENCH_ENTRIES - 1; i >= 0; i--) {
+        if (!find_entry(linear, names[i].name)) misses++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double lookup_ms = elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 2; i < linear->entry_cnt; i++) found[i - 2] = &linear->entries[i];
+    sorted_listing(listing, found, linear->entry_cnt - 2);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Directory         %9.1f   %9.1f   %17.1f\n", insert_ms, lookup_ms, elapsed_ms(&start, &end));
+    free_directory(linear);
+
+    // HashDirectory: fixed 1024 chained buckets
+    HashDirectory *hashed = create_hash_directory();
+    if (!hashed) return 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ENTRIES; i++) hash_directory_insert(hashed, names[i]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    insert_ms = elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = BENCH_ENTRIES - 1; i >= 0; i--) {
+        if (!hash_directory_lookup(hashed, names[i].name)) misses++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    lookup_ms = elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t n = 0;
+    for (int b = 0; b < HASH_SIZE; b++) {
+        for (HashNode *node = hashed->buckets[b]; node; node = node->next) found[n++] = &node->entry;
+    }
+    sorted_listing(listing, found, n);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("HashDirectory     %9.1f   %9.1f   %17.1f\n", insert_ms, lookup_ms, elapsed_ms(&start, &end));
+
+    for (int b = 0; b < HASH_SIZE; b++) {
+        HashNode *node = hashed->buckets[b];
+        while (node) {
+            HashNode *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(hashed);
+
+    // BTreeDirectory built by inserts
+    BTreeDirectory *tree = create_btree_directory();
+    if (!tree) return 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ENTRIES; i++) btree_directory_insert(tree, names[i]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    insert_ms = elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = BENCH_ENTRIES - 1; i >= 0; i--) {
+        if (!btree_directory_lookup(tree, names[i].name)) misses++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    lookup_ms = elapsed_ms(&start, &end);
+
+    ListingCheck check = { NULL, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t listed = btree_directory_scan(tree, "", check_order, &check);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("BTreeDirectory    %9.1f   %9.1f   %17.1f  (height %d)\n",
+           insert_ms, lookup_ms, elapsed_ms(&start, &end), tree->height);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t prefixed = btree_directory_scan(tree, "msg-7", NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("prefix scan \"msg-7\": %zu entries in %.3f ms\n", prefixed, elapsed_ms(&start, &end));
+    destroy_btree_directory(tree);
+
+    // BTreeDirectory bulk loaded from a sorted listing
+    qsort(names, BENCH_ENTRIES, sizeof(DirectoryEntry), compare_entries);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tree = btree_directory_bulk_load(names, BENCH_ENTRIES);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!tree) return 1;
+    insert_ms = elapsed_ms(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = BENCH_ENTRIES - 1; i >= 0; i--) {
+        if (!btree_directory_lookup(tree, names[i].name)) misses++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("BTree bulk load   %9.1f   %9.1f                     (height %d)\n",
+           insert_ms, elapsed_ms(&start, &end), tree->height);
+    destroy_btree_directory(tree);
+
+    printf("missed lookups: %zu, listed %zu, out of order: %zu\n", misses, listed, check.out_of_order);
+
+    free(names);
+    free(listing);
+    free(found);
+
+    return 0;
+}
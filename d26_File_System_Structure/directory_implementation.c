@@ -6,7 +6,8 @@
 
 #define MAX_NAME_LEN 255
 #define MAX_PATH_LEN 4096
-#define MAX_ENTRIES  1024
+#define INITIAL_ENTRIES 16              // entries array and hash index both start here and double
+#define RESIZE_STEP 64                  // old buckets migrated per operation while the index grows
 
 
 typedef enum EntryType {
@@ -26,65 +27,214 @@ typedef struct DirectoryEntry {
     mode_t permissions;
     ino_t inode_num;
     struct DirectoryEntry *parent;
+    unsigned int name_hash;             // cached so chains compare hashes before names
+    int hash_next;                      // next entry index in the same bucket, -1 ends the chain
 } DirectoryEntry;
 
 
+/*
+Entries stay in one growable array, so callers can still iterate
+entries[0..entry_cnt). Lookups go through a chained hash index whose chains
+are threaded through the entries by index. When the index fills up it
+doubles, but like ext4's htree splits (and Redis' rehash) the work is spread
+out: the old bucket array is kept and RESIZE_STEP of its buckets move to the
+new one on every lookup, insert or remove, so no single operation pays for
+rehashing a huge directory. A bucket below migrate_pos lives in the new
+array, one at or above it still lives in the old one.
+
+Pointers returned by find_entry stay valid until the next add or remove.
+*/
 typedef struct Directory {
     DirectoryEntry *entries;
     size_t entry_cnt;
     size_t capacity;
     char path[MAX_PATH_LEN];
+
+    int *buckets;
+    size_t bucket_mask;
+    int *old_buckets;                   // non-NULL while a resize is in progress
+    size_t old_bucket_mask;
+    size_t migrate_pos;
 } Directory;
 
 
+// FNV-1a
+static unsigned int directory_hash(const char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+// head of the chain that holds (or will hold) names with this hash
+static int *bucket_for(Directory *dir, unsigned int hash) {
+    if (dir->old_buckets && (hash & dir->old_bucket_mask) >= dir->migrate_pos) {
+        return &dir->old_buckets[hash & dir->old_bucket_mask];
+    }
+
+    return &dir->buckets[hash & dir->bucket_mask];
+}
+
+
+static void migrate_buckets(Directory *dir, size_t count) {
+    while (dir->old_buckets && count-- > 0) {
+        int idx = dir->old_buckets[dir->migrate_pos];
+
+        while (idx >= 0) {
+            DirectoryEntry *entry = &dir->entries[idx];
+            int next = entry->hash_next;
+            int *head = &dir->buckets[entry->name_hash & dir->bucket_mask];
+
+            entry->hash_next = *head;
+            *head = idx;
+            idx = next;
+        }
+
+        if (++dir->migrate_pos > dir->old_bucket_mask) {
+            free(dir->old_buckets);
+            dir->old_buckets = NULL;
+        }
+    }
+}
+
+
+static int *new_buckets(size_t count) {
+    int *buckets = malloc(count * sizeof(int));
+    if (!buckets) return NULL;
+
+    memset(buckets, 0xFF, count * sizeof(int));     // every head -1
+    return buckets;
+}
+
+
+// double the bucket array; the old one drains as operations come in
+static int grow_index(Directory *dir) {
+    if (dir->old_buckets) {
+        migrate_buckets(dir, dir->old_bucket_mask + 1);
+    }
+
+    int *buckets = new_buckets((dir->bucket_mask + 1) * 2);
+    if (!buckets) return -1;
+
+    dir->old_buckets = dir->buckets;
+    dir->old_bucket_mask = dir->bucket_mask;
+    dir->migrate_pos = 0;
+    dir->buckets = buckets;
+    dir->bucket_mask = dir->bucket_mask * 2 + 1;
+
+    return 0;
+}
+
+
+static void index_entry(Directory *dir, int idx) {
+    DirectoryEntry *entry = &dir->entries[idx];
+    int *head = bucket_for(dir, entry->name_hash);
+
+    entry->hash_next = *head;
+    *head = idx;
+}
+
+
+// find the link (bucket head or hash_next) that points at entry idx
+static int *link_to(Directory *dir, int idx) {
+    int *link = bucket_for(dir, dir->entries[idx].name_hash);
+    while (*link != idx) {
+        link = &dir->entries[*link].hash_next;
+    }
+
+    return link;
+}
+
+
+static DirectoryEntry *append_entry(Directory *dir, const char *name, EntryType type) {
+    if (dir->entry_cnt == dir->capacity) {
+        DirectoryEntry *old_base = dir->entries;
+        DirectoryEntry *entries = realloc(dir->entries, dir->capacity * 2 * sizeof(DirectoryEntry));
+        if (!entries) return NULL;
+
+        dir->entries = entries;
+        dir->capacity *= 2;
+
+        // entries point at "." as their parent; re-aim them at the moved array
+        if (entries != old_base) {
+            for (size_t i = 0; i < dir->entry_cnt; ++i) {
+                if (entries[i].parent) entries[i].parent = &entries[0];
+            }
+        }
+    }
+
+    if (dir->entry_cnt > dir->bucket_mask && grow_index(dir) < 0) {
+        return NULL;
+    }
+
+    int idx = (int)dir->entry_cnt++;
+    DirectoryEntry *entry = &dir->entries[idx];
+    memset(entry, 0, sizeof(DirectoryEntry));
+    strncpy(entry->name, name, MAX_NAME_LEN - 1);
+    entry->type = type;
+    entry->created_time = time(NULL);
+    entry->modified_time = entry->created_time;
+    entry->name_hash = directory_hash(entry->name);
+    index_entry(dir, idx);
+
+    return entry;
+}
+
+
 // create a new directory struct
 Directory *init_directory(const char *path) {
     Directory *dir = malloc(sizeof(Directory));
     if (!dir) return NULL;
 
-    dir->entries = malloc(sizeof(DirectoryEntry) * MAX_ENTRIES);
-    if (!dir->entries) {
+    memset(dir, 0, sizeof(Directory));
+    dir->entries = malloc(sizeof(DirectoryEntry) * INITIAL_ENTRIES);
+    dir->buckets = new_buckets(INITIAL_ENTRIES);
+    if (!dir->entries || !dir->buckets) {
+        free(dir->entries);
+        free(dir->buckets);
         free(dir);
         return NULL;
     }
 
     dir->entry_cnt = 0;
-    dir->capacity = MAX_ENTRIES;
+    dir->capacity = INITIAL_ENTRIES;
+    dir->bucket_mask = INITIAL_ENTRIES - 1;
     strncpy(dir->path, path, MAX_PATH_LEN - 1);
 
     // create "." and ".." entries
-    DirectoryEntry *curr = &dir->entries[dir->entry_cnt++];
-    strncpy(curr->name, ".", MAX_NAME_LEN);
-    curr->type = ENTRY_TYPE_DIRECTORY;
-    curr->created_time = time(NULL);
-    curr->modified_time = curr->created_time;
-    curr->parent = NULL;
-
-    DirectoryEntry *parent = &dir->entries[dir->entry_cnt++];
-    strncpy(curr->name, "..", MAX_NAME_LEN);
-    curr->type = ENTRY_TYPE_DIRECTORY;
-    curr->created_time = time(NULL);
-    curr->modified_time = curr->created_time;
-    curr->parent = NULL;
+    append_entry(dir, ".", ENTRY_TYPE_DIRECTORY);
+    append_entry(dir, "..", ENTRY_TYPE_DIRECTORY);
 
     return dir;
 }
 
 
+void free_directory(Directory *dir) {
+    if (!dir) return;
+
+    free(dir->entries);
+    free(dir->buckets);
+    free(dir->old_buckets);
+    free(dir);
+}
+
+
 // add entry to directory
 int add_directory_entry(Directory *dir, const char *name, EntryType type) {
-    if (!dir || !name || dir->entry_cnt >= dir->capacity) {
+    if (!dir || !name) {
         return -1;
     }
 
-    DirectoryEntry *entry = &dir->entries[dir->entry_cnt];
-    strncpy(entry->name, name, MAX_NAME_LEN - 1);
-    entry->type = type;
-    entry->created_time = time(NULL);
-    entry->modified_time = entry->created_time;
-    entry->parent = &dir->entries[0];   // point to "." entry
+    migrate_buckets(dir, RESIZE_STEP);
 
-    dir->entry_cnt++;
+    DirectoryEntry *entry = append_entry(dir, name, type);
+    if (!entry) return -1;
+
+    entry->parent = &dir->entries[0];   // point to "." entry
 
     return 0;
 }
@@ -94,11 +244,37 @@ int add_directory_entry(Directory *dir, const char *name, EntryType type) {
 DirectoryEntry *find_entry(Directory *dir, const char *name) {
     if (!dir || !name) return NULL;
 
-    for (size_t i = 0; i < dir->entry_cnt; ++i) {
-        if (strcmp(dir->entries[i].name, name) == 0) {
-            return &dir->entries[i];
+    migrate_buckets(dir, RESIZE_STEP);
+
+    unsigned int hash = directory_hash(name);
+    for (int idx = *bucket_for(dir, hash); idx >= 0; idx = dir->entries[idx].hash_next) {
+        DirectoryEntry *entry = &dir->entries[idx];
+        if (entry->name_hash == hash && strcmp(entry->name, name) == 0) {
+            return entry;
         }
     }
 
     return NULL;
 }
+
+
+// remove entry from directory; the last entry moves into its slot
+int remove_directory_entry(Directory *dir, const char *name) {
+    DirectoryEntry *entry = find_entry(dir, name);
+    if (!entry || entry == &dir->entries[0] || entry == &dir->entries[1]) {
+        return -1;      // missing, or "." / ".."
+    }
+
+    int idx = (int)(entry - dir->entries);
+    int last = (int)dir->entry_cnt - 1;
+
+    *link_to(dir, idx) = entry->hash_next;
+
+    if (idx != last) {
+        *link_to(dir, last) = idx;
+        dir->entries[idx] = dir->entries[last];
+    }
+    dir->entry_cnt--;
+
+    return 0;
+}
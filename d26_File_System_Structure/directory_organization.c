@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "directory_implementation.c"
 
@@ -24,19 +25,39 @@ typedef struct HashDirectory {
 } HashDirectory;
 
 
-// B-Tree implementation
-#define BTREE_ORDER 5
+// B+-tree implementation
+#define BTREE_ORDER 8                   // children per internal node
+#define BTREE_KEYS (BTREE_ORDER - 1)
 
+/*
+Every node starts with one cache line holding the first 8 bytes of each key,
+packed big-endian so integer order matches strcmp order, plus the count and
+leaf flag. Searching a node compares those prefixes and only follows a key
+pointer to the full name when two prefixes tie. Entries live only in the
+leaves, which are chained left to right, so sorted listings and prefix scans
+walk leaves sequentially instead of revisiting the tree.
+*/
 typedef struct BTreeNode {
-    Directory *entries[BTREE_ORDER - 1];
-    struct BTreeNode *children[BTREE_ORDER];
+    uint64_t prefix[BTREE_KEYS];
     int count;
-     int leaf;
-} BTreeNode;
+    int leaf;
+    const char *keys[BTREE_KEYS];       // full names: entry names in leaves, separators inside
+    union {
+        struct BTreeNode *children[BTREE_ORDER];
+        struct {
+            DirectoryEntry *entries[BTREE_KEYS];
+            struct BTreeNode *next;     // next leaf in key order
+        };
+    };
+} __attribute__((aligned(64))) BTreeNode;
 
 
 typedef struct BTreeDirectory {
     BTreeNode *root;
+    size_t count;
+    int height;
+    BTreeNode *reserve;         // spare nodes for splits, linked through children[0]
+    int reserve_count;
 } BTreeDirectory;
 
 
@@ -93,3 +114,433 @@ DirectoryEntry *hash_directory_lookup(HashDirectory *dir, const char *name) {
 
     return NULL;
 }
+
+
+// first 8 bytes of a name, big-endian and zero-padded
+static uint64_t key_prefix(const char *name) {
+    uint64_t prefix = 0;
+    int i = 0;
+
+    for (; i < 8 && name[i]; i++) {
+        prefix = (prefix << 8) | (unsigned char)name[i];
+    }
+
+    return i ? prefix << (8 * (8 - i)) : 0;
+}
+
+
+static int btree_compare(uint64_t prefix_a, const char *a, uint64_t prefix_b, const char *b) {
+    if (prefix_a != prefix_b) return prefix_a < prefix_b ? -1 : 1;
+    return strcmp(a, b);
+}
+
+
+// first key in node that is >= (prefix, name)
+static int node_lower_bound(BTreeNode *node, uint64_t prefix, const char *name) {
+    int i = 0;
+    while (i < node->count && btree_compare(node->prefix[i], node->keys[i], prefix, name) < 0) i++;
+
+    return i;
+}
+
+
+// child of an internal node that covers (prefix, name): separators <= name go left of it
+static int node_child(BTreeNode *node, uint64_t prefix, const char *name) {
+    int i = 0;
+    while (i < node->count && btree_compare(node->prefix[i], node->keys[i], prefix, name) <= 0) i++;
+
+    return i;
+}
+
+
+static BTreeNode *create_btree_node(int leaf) {
+    BTreeNode *node = aligned_alloc(64, sizeof(BTreeNode));
+    if (!node) return NULL;
+
+    memset(node, 0, sizeof(BTreeNode));
+    node->leaf = leaf;
+
+    return node;
+}
+
+
+BTreeDirectory *create_btree_directory() {
+    BTreeDirectory *dir = malloc(sizeof(BTreeDirectory));
+    if (!dir) return NULL;
+
+    dir->root = create_btree_node(1);
+    if (!dir->root) {
+        free(dir);
+        return NULL;
+    }
+
+    dir->count = 0;
+    dir->height = 1;
+    dir->reserve = NULL;
+    dir->reserve_count = 0;
+
+    return dir;
+}
+
+
+/*
+An insert splits at most one node per level and may add a root, so it is
+given height + 1 nodes before it touches the tree; running out of memory
+then fails the insert up front instead of leaving a half-linked split.
+*/
+static int reserve_nodes(BTreeDirectory *dir) {
+    while (dir->reserve_count < dir->height + 1) {
+        BTreeNode *node = create_btree_node(0);
+        if (!node) return -1;
+
+        node->children[0] = dir->reserve;
+        dir->reserve = node;
+        dir->reserve_count++;
+    }
+    return 0;
+}
+
+
+static BTreeNode *take_reserved_node(BTreeDirectory *dir, int leaf) {
+    BTreeNode *node = dir->reserve;
+    dir->reserve = node->children[0];
+    dir->reserve_count--;
+
+    memset(node, 0, sizeof(BTreeNode));
+    node->leaf = leaf;
+    return node;
+}
+
+
+static void destroy_btree_node(BTreeNode *node) {
+    if (node->leaf) {
+        for (int i = 0; i < node->count; i++) free(node->entries[i]);
+    } else {
+        for (int i = 0; i <= node->count; i++) destroy_btree_node(node->children[i]);
+    }
+    free(node);
+}
+
+
+void destroy_btree_directory(BTreeDirectory *dir) {
+    if (!dir) return;
+
+    destroy_btree_node(dir->root);
+    while (dir->reserve) {
+        BTreeNode *next = dir->reserve->children[0];
+        free(dir->reserve);
+        dir->reserve = next;
+    }
+    free(dir);
+}
+
+
+/*
+Insert into the subtree under node. When node has to split, the new right
+sibling is returned and its smallest key is passed up through sep_prefix /
+sep_key for the parent to insert. *status is -1 if the name already exists,
+which is found before anything changes. New nodes come from dir's reserve.
+*/
+static BTreeNode *btree_insert_node(BTreeDirectory *dir, BTreeNode *node, DirectoryEntry *entry, uint64_t prefix,
+                                    uint64_t *sep_prefix, const char **sep_key, int *status) {
+    uint64_t prefixes[BTREE_KEYS + 1];
+    const char *keys[BTREE_KEYS + 1];
+    int pos;
+
+    if (node->leaf) {
+        pos = node_lower_bound(node, prefix, entry->name);
+        if (pos < node->count && btree_compare(node->prefix[pos], node->keys[pos], prefix, entry->name) == 0) {
+            *status = -1;
+            return NULL;
+        }
+
+        if (node->count < BTREE_KEYS) {
+            memmove(&node->prefix[pos + 1], &node->prefix[pos], (node->count - pos) * sizeof(uint64_t));
+            memmove(&node->keys[pos + 1], &node->keys[pos], (node->count - pos) * sizeof(char*));
+            memmove(&node->entries[pos + 1], &node->entries[pos], (node->count - pos) * sizeof(DirectoryEntry*));
+            node->prefix[pos] = prefix;
+            node->keys[pos] = entry->name;
+            node->entries[pos] = entry;
+            node->count++;
+            return NULL;
+        }
+
+        // full leaf: split the BTREE_KEYS + 1 entries in half
+        BTreeNode *right = take_reserved_node(dir, 1);
+
+        DirectoryEntry *entries[BTREE_KEYS + 1];
+        for (int i = 0, j = 0; i <= BTREE_KEYS; i++) {
+            if (i == pos) {
+                prefixes[i] = prefix;
+                keys[i] = entry->name;
+                entries[i] = entry;
+            } else {
+                prefixes[i] = node->prefix[j];
+                keys[i] = node->keys[j];
+                entries[i] = node->entries[j];
+                j++;
+            }
+        }
+
+        int left_count = (BTREE_KEYS + 1) / 2;
+        node->count = left_count;
+        right->count = BTREE_KEYS + 1 - left_count;
+        for (int i = 0; i < left_count; i++) {
+            node->prefix[i] = prefixes[i];
+            node->keys[i] = keys[i];
+            node->entries[i] = entries[i];
+        }
+        for (int i = 0; i < right->count; i++) {
+            right->prefix[i] = prefixes[left_count + i];
+            right->keys[i] = keys[left_count + i];
+            right->entries[i] = entries[left_count + i];
+        }
+
+        right->next = node->next;
+        node->next = right;
+        *sep_prefix = right->prefix[0];
+        *sep_key = right->keys[0];
+        return right;
+    }
+
+    pos = node_child(node, prefix, entry->name);
+
+    uint64_t child_prefix;
+    const char *child_key;
+    BTreeNode *split = btree_insert_node(dir, node->children[pos], entry, prefix, &child_prefix, &child_key, status);
+    if (!split) return NULL;
+
+    if (node->count < BTREE_KEYS) {
+        memmove(&node->prefix[pos + 1], &node->prefix[pos], (node->count - pos) * sizeof(uint64_t));
+        memmove(&node->keys[pos + 1], &node->keys[pos], (node->count - pos) * sizeof(char*));
+        memmove(&node->children[pos + 2], &node->children[pos + 1], (node->count - pos) * sizeof(BTreeNode*));
+        node->prefix[pos] = child_prefix;
+        node->keys[pos] = child_key;
+        node->children[pos + 1] = split;
+        node->count++;
+        return NULL;
+    }
+
+    // full internal node: the middle separator moves up
+    BTreeNode *right = take_reserved_node(dir, 0);
+
+    BTreeNode *children[BTREE_ORDER + 1];
+    for (int i = 0, j = 0; i <= BTREE_KEYS; i++) {
+        if (i == pos) {
+            prefixes[i] = child_prefix;
+            keys[i] = child_key;
+        } else {
+            prefixes[i] = node->prefix[j];
+            keys[i] = node->keys[j];
+            j++;
+        }
+    }
+    for (int i = 0, j = 0; i <= BTREE_ORDER; i++) {
+        children[i] = (i == pos + 1) ? split : node->children[j++];
+    }
+
+    int mid = (BTREE_KEYS + 1) / 2;
+    node->count = mid;
+    right->count = BTREE_KEYS - mid;
+    for (int i = 0; i < mid; i++) {
+        node->prefix[i] = prefixes[i];
+        node->keys[i] = keys[i];
+        node->children[i] = children[i];
+    }
+    node->children[mid] = children[mid];
+    for (int i = 0; i < right->count; i++) {
+        right->prefix[i] = prefixes[mid + 1 + i];
+        right->keys[i] = keys[mid + 1 + i];
+        right->children[i] = children[mid + 1 + i];
+    }
+    right->children[right->count] = children[BTREE_ORDER];
+
+    *sep_prefix = prefixes[mid];
+    *sep_key = keys[mid];
+    return right;
+}
+
+
+int btree_directory_insert(BTreeDirectory *dir, DirectoryEntry entry) {
+    if (!dir || reserve_nodes(dir) < 0) return -1;
+
+    DirectoryEntry *copy = malloc(sizeof(DirectoryEntry));
+    if (!copy) return -1;
+    *copy = entry;
+
+    uint64_t sep_prefix;
+    const char *sep_key;
+    int status = 0;
+    BTreeNode *split = btree_insert_node(dir, dir->root, copy, key_prefix(copy->name), &sep_prefix, &sep_key, &status);
+
+    if (status < 0) {
+        free(copy);
+        return -1;
+    }
+
+    if (split) {
+        BTreeNode *root = take_reserved_node(dir, 0);
+        root->count = 1;
+        root->prefix[0] = sep_prefix;
+        root->keys[0] = sep_key;
+        root->children[0] = dir->root;
+        root->children[1] = split;
+        dir->root = root;
+        dir->height++;
+    }
+
+    dir->count++;
+    return 0;
+}
+
+
+// leaf that would hold name, and the position of the first key >= name in it
+static BTreeNode *btree_find_leaf(BTreeDirectory *dir, const char *name, int *pos) {
+    uint64_t prefix = key_prefix(name);
+    BTreeNode *node = dir->root;
+
+    while (!node->leaf) {
+        node = node->children[node_child(node, prefix, name)];
+    }
+
+    *pos = node_lower_bound(node, prefix, name);
+    return node;
+}
+
+
+DirectoryEntry *btree_directory_lookup(BTreeDirectory *dir, const char *name) {
+    if (!dir || !name) return NULL;
+
+    int pos;
+    BTreeNode *leaf = btree_find_leaf(dir, name, &pos);
+
+    if (pos < leaf->count && strcmp(leaf->keys[pos], name) == 0) {
+        return leaf->entries[pos];
+    }
+
+    return NULL;
+}
+
+
+// call callback on every entry whose name starts with prefix, in sorted order; "" lists everything
+size_t btree_directory_scan(BTreeDirectory *dir, const char *prefix,
+                            void (*callback)(DirectoryEntry *entry, void *arg), void *arg) {
+    if (!dir || !prefix) return 0;
+
+    size_t prefix_len = strlen(prefix);
+    size_t visited = 0;
+    int pos;
+    BTreeNode *leaf = btree_find_leaf(dir, prefix, &pos);
+
+    for (; leaf; leaf = leaf->next, pos = 0) {
+        for (; pos < leaf->count; pos++) {
+            if (strncmp(leaf->keys[pos], prefix, prefix_len) != 0) return visited;
+
+            if (callback) callback(leaf->entries[pos], arg);
+            visited++;
+        }
+    }
+
+    return visited;
+}
+
+
+/*
+Build a tree from entries already sorted by name, bottom up: leaves are
+packed full and linked, then each level of parents is made from the one
+below. O(n) instead of n top-down inserts. Returns NULL if the input is not
+strictly sorted.
+*/
+BTreeDirectory *btree_directory_bulk_load(const DirectoryEntry *entries, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(entries[i - 1].name, entries[i].name) >= 0) return NULL;
+    }
+
+    BTreeDirectory *dir = create_btree_directory();
+    if (!dir || count == 0) return dir;
+
+    size_t leaf_count = (count + BTREE_KEYS - 1) / BTREE_KEYS;
+    size_t level_count = leaf_count;
+    size_t internal_count = 0;
+    BTreeNode *first_leaf = NULL;
+    BTreeNode **level = malloc(leaf_count * sizeof(BTreeNode*));
+    BTreeNode **internal = malloc(leaf_count * sizeof(BTreeNode*));     // fewer internal nodes than leaves
+    uint64_t *low_prefix = malloc(leaf_count * sizeof(uint64_t));      // smallest key under each node
+    const char **low_key = malloc(leaf_count * sizeof(char*));
+    if (!level || !internal || !low_prefix || !low_key) goto fail;
+
+    BTreeNode *prev = NULL;
+    for (size_t n = 0, i = 0; n < leaf_count; n++) {
+        BTreeNode *leaf = create_btree_node(1);
+        if (!leaf) goto fail;
+        if (prev) prev->next = leaf;
+        else first_leaf = leaf;
+        prev = leaf;
+        level[n] = leaf;
+
+        for (; i < count && leaf->count < BTREE_KEYS; i++) {
+            DirectoryEntry *copy = malloc(sizeof(DirectoryEntry));
+            if (!copy) goto fail;
+            *copy = entries[i];
+
+            leaf->entries[leaf->count] = copy;
+            leaf->keys[leaf->count] = copy->name;
+            leaf->prefix[leaf->count] = key_prefix(copy->name);
+            leaf->count++;
+        }
+        low_prefix[n] = leaf->prefix[0];
+        low_key[n] = leaf->keys[0];
+    }
+
+    int height = 1;
+    while (level_count > 1) {
+        size_t parents = (level_count + BTREE_ORDER - 1) / BTREE_ORDER;
+
+        // parent p takes children [p * ORDER, ...); entries are read ahead of where they are overwritten
+        for (size_t p = 0, c = 0; p < parents; p++) {
+            BTreeNode *node = create_btree_node(0);
+            if (!node) goto fail;
+            internal[internal_count++] = node;
+
+            uint64_t first_prefix = low_prefix[c];
+            const char *first_key = low_key[c];
+            node->children[0] = level[c++];
+            for (; c < level_count && node->count < BTREE_KEYS; c++) {
+                node->prefix[node->count] = low_prefix[c];
+                node->keys[node->count] = low_key[c];
+                node->children[++node->count] = level[c];
+            }
+
+            level[p] = node;
+            low_prefix[p] = first_prefix;
+            low_key[p] = first_key;
+        }
+
+        level_count = parents;
+        height++;
+    }
+
+    free(dir->root);
+    dir->root = level[0];
+    dir->count = count;
+    dir->height = height;
+    free(level);
+    free(internal);
+    free(low_prefix);
+    free(low_key);
+    return dir;
+
+fail:
+    while (first_leaf) {
+        BTreeNode *next = first_leaf->next;
+        destroy_btree_node(first_leaf);
+        first_leaf = next;
+    }
+    for (size_t i = 0; i < internal_count; i++) free(internal[i]);
+    free(level);
+    free(internal);
+    free(low_prefix);
+    free(low_key);
+    destroy_btree_directory(dir);
+    return NULL;
+}
@@ -10,6 +10,11 @@ It’s particularly effective for large files and is used in many modern file sy
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#define BY_START 0                      // free-extent tree keyed by start block
+#define BY_LENGTH 1                     // free-extent tree keyed by (length, start)
+#define LOCALITY_PROBES 16              // neighbours examined around a target before falling back to best fit
 
 
 typedef struct Extent {
@@ -19,11 +24,28 @@ typedef struct Extent {
 } Extent;
 
 
+/*
+Free space is a set of maximal free extents indexed twice, as XFS does with
+its by-block and by-count btrees. Each node lives in both AVL trees at once
+(one set of links per tree): the start-keyed tree finds neighbours for
+merging and extents near a locality target, the length-keyed tree finds the
+best fit. Both are O(log n) in the number of free extents, independent of
+disk size.
+*/
+typedef struct FreeExtent {
+    int start;
+    int length;
+    struct FreeExtent *child[2][2];     // [tree][left, right]
+    int height[2];
+} FreeExtent;
+
+
 typedef struct ExtentFile {
     char name[256];
     Extent *extent_list;
     size_t size;
     int extent_count;
+    int delayed_blocks;                 // reserved but not yet placed on disk
 } ExtentFile;
 
 
@@ -31,21 +53,196 @@ typedef struct ExtentAllocator {
     int *disk_blocks;
     int total_blocks;
     int free_blocks;
+    int reserved_blocks;                // promised to delayed allocations
+    FreeExtent *free_tree[2];
+    int free_extent_count;
     ExtentFile *files;
     int max_files;
 } ExtentAllocator;
 
 
+static int extent_compare(int tree, const FreeExtent *a, const FreeExtent *b) {
+    if (tree == BY_LENGTH && a->length != b->length) {
+        return a->length < b->length ? -1 : 1;
+    }
+    return (a->start > b->start) - (a->start < b->start);
+}
+
+
+static int tree_height(const FreeExtent *node, int tree) {
+    return node ? node->height[tree] : 0;
+}
+
+
+static void update_height(FreeExtent *node, int tree) {
+    int left = tree_height(node->child[tree][0], tree);
+    int right = tree_height(node->child[tree][1], tree);
+    node->height[tree] = (left > right ? left : right) + 1;
+}
+
+
+// dir 1 rotates right (left child comes up), dir 0 rotates left
+static FreeExtent *rotate(FreeExtent *node, int tree, int dir) {
+    FreeExtent *pivot = node->child[tree][!dir];
+    node->child[tree][!dir] = pivot->child[tree][dir];
+    pivot->child[tree][dir] = node;
+    update_height(node, tree);
+    update_height(pivot, tree);
+    return pivot;
+}
+
+
+static FreeExtent *rebalance(FreeExtent *node, int tree) {
+    update_height(node, tree);
+    int balance = tree_height(node->child[tree][0], tree) - tree_height(node->child[tree][1], tree);
+
+    if (balance > 1) {
+        FreeExtent *left = node->child[tree][0];
+        if (tree_height(left->child[tree][0], tree) < tree_height(left->child[tree][1], tree)) {
+            node->child[tree][0] = rotate(left, tree, 0);
+        }
+        return rotate(node, tree, 1);
+    }
+    if (balance < -1) {
+        FreeExtent *right = node->child[tree][1];
+        if (tree_height(right->child[tree][1], tree) < tree_height(right->child[tree][0], tree)) {
+            node->child[tree][1] = rotate(right, tree, 1);
+        }
+        return rotate(node, tree, 0);
+    }
+    return node;
+}
+
+
+static FreeExtent *tree_insert(FreeExtent *root, int tree, FreeExtent *node) {
+    if (!root) {
+        node->child[tree][0] = node->child[tree][1] = NULL;
+        node->height[tree] = 1;
+        return node;
+    }
+
+    int dir = extent_compare(tree, node, root) > 0;
+    root->child[tree][dir] = tree_insert(root->child[tree][dir], tree, node);
+    return rebalance(root, tree);
+}
+
+
+static FreeExtent *tree_remove_min(FreeExtent *root, int tree, FreeExtent **min) {
+    if (!root->child[tree][0]) {
+        *min = root;
+        return root->child[tree][1];
+    }
+    root->child[tree][0] = tree_remove_min(root->child[tree][0], tree, min);
+    return rebalance(root, tree);
+}
+
+
+static FreeExtent *tree_remove(FreeExtent *root, int tree, FreeExtent *node) {
+    if (!root) return NULL;
+
+    if (root != node) {
+        int dir = extent_compare(tree, node, root) > 0;
+        root->child[tree][dir] = tree_remove(root->child[tree][dir], tree, node);
+        return rebalance(root, tree);
+    }
+
+    FreeExtent *left = root->child[tree][0];
+    FreeExtent *right = root->child[tree][1];
+    if (!left) return right;
+    if (!right) return left;
+
+    FreeExtent *successor;
+    right = tree_remove_min(right, tree, &successor);
+    successor->child[tree][0] = left;
+    successor->child[tree][1] = right;
+    return rebalance(successor, tree);
+}
+
+
+static void free_space_insert(ExtentAllocator *allocator, FreeExtent *node) {
+    allocator->free_tree[BY_START] = tree_insert(allocator->free_tree[BY_START], BY_START, node);
+    allocator->free_tree[BY_LENGTH] = tree_insert(allocator->free_tree[BY_LENGTH], BY_LENGTH, node);
+    allocator->free_extent_count++;
+}
+
+
+static void free_space_remove(ExtentAllocator *allocator, FreeExtent *node) {
+    allocator->free_tree[BY_START] = tree_remove(allocator->free_tree[BY_START], BY_START, node);
+    allocator->free_tree[BY_LENGTH] = tree_remove(allocator->free_tree[BY_LENGTH], BY_LENGTH, node);
+    allocator->free_extent_count--;
+}
+
+
+// free extent with the largest start <= block, or NULL
+static FreeExtent *extent_at_or_before(ExtentAllocator *allocator, int block) {
+    FreeExtent *node = allocator->free_tree[BY_START];
+    FreeExtent *found = NULL;
+
+    while (node) {
+        if (node->start <= block) {
+            found = node;
+            node = node->child[BY_START][1];
+        } else {
+            node = node->child[BY_START][0];
+        }
+    }
+    return found;
+}
+
+
+// free extent with the smallest start >= block, or NULL
+static FreeExtent *extent_at_or_after(ExtentAllocator *allocator, int block) {
+    FreeExtent *node = allocator->free_tree[BY_START];
+    FreeExtent *found = NULL;
+
+    while (node) {
+        if (node->start >= block) {
+            found = node;
+            node = node->child[BY_START][0];
+        } else {
+            node = node->child[BY_START][1];
+        }
+    }
+    return found;
+}
+
+
+// smallest free extent that holds length blocks, lowest start among equals
+static FreeExtent *best_fit(ExtentAllocator *allocator, int length) {
+    FreeExtent *node = allocator->free_tree[BY_LENGTH];
+    FreeExtent *found = NULL;
+
+    while (node) {
+        if (node->length >= length) {
+            found = node;
+            node = node->child[BY_LENGTH][0];
+        } else {
+            node = node->child[BY_LENGTH][1];
+        }
+    }
+    return found;
+}
+
+
+static FreeExtent *largest_free_extent(ExtentAllocator *allocator) {
+    FreeExtent *node = allocator->free_tree[BY_LENGTH];
+    while (node && node->child[BY_LENGTH][1]) node = node->child[BY_LENGTH][1];
+    return node;
+}
+
+
 ExtentAllocator *init_extent_allocator(int total_blocks, int max_files) {
-    ExtentAllocator *allocator = malloc(sizeof(ExtentAllocator));
+    ExtentAllocator *allocator = calloc(1, sizeof(ExtentAllocator));
     if (!allocator) return NULL;
 
-    allocator->disk_blocks = malloc(total_blocks * sizeof(int));
+    allocator->disk_blocks = calloc(total_blocks, sizeof(int));
     allocator->files = calloc(max_files, sizeof(ExtentFile));
+    FreeExtent *whole_disk = calloc(1, sizeof(FreeExtent));
 
-    if (!allocator->disk_blocks || !allocator->files) {
+    if (!allocator->disk_blocks || !allocator->files || !whole_disk) {
         if (allocator->disk_blocks) free(allocator->disk_blocks);
         if (allocator->files) free(allocator->files);
+        if (whole_disk) free(whole_disk);
         free(allocator);
 
         return NULL;
@@ -55,12 +252,236 @@ ExtentAllocator *init_extent_allocator(int total_blocks, int max_files) {
     allocator->free_blocks = total_blocks;
     allocator->max_files = max_files;
 
+    whole_disk->start = 0;
+    whole_disk->length = total_blocks;
+    free_space_insert(allocator, whole_disk);
+
     return allocator;
 }
 
 
-// allocate new extent
+static void destroy_free_tree(FreeExtent *node) {
+    if (!node) return;
+    destroy_free_tree(node->child[BY_START][0]);
+    destroy_free_tree(node->child[BY_START][1]);
+    free(node);
+}
+
+
+void destroy_extent_allocator(ExtentAllocator *allocator) {
+    for (int i = 0; i < allocator->max_files; i++) {
+        Extent *extent = allocator->files[i].extent_list;
+        while (extent) {
+            Extent *next = extent->next;
+            free(extent);
+            extent = next;
+        }
+    }
+
+    destroy_free_tree(allocator->free_tree[BY_START]);
+    free(allocator->disk_blocks);
+    free(allocator->files);
+    free(allocator);
+}
+
+
+// take [at, at + length) out of free extent fe, returning the leftover pieces to the trees
+static Extent *carve_extent(ExtentAllocator *allocator, FreeExtent *fe, int at, int length) {
+    Extent *extent = malloc(sizeof(Extent));
+    if (!extent) return NULL;
+
+    int end = fe->start + fe->length;
+    free_space_remove(allocator, fe);
+
+    if (at > fe->start) {
+        fe->length = at - fe->start;
+        free_space_insert(allocator, fe);
+        fe = NULL;
+    }
+
+    if (at + length < end) {
+        FreeExtent *rest = fe ? fe : malloc(sizeof(FreeExtent));
+        if (rest) {
+            rest->start = at + length;
+            rest->length = end - (at + length);
+            free_space_insert(allocator, rest);
+        }
+        fe = NULL;
+    }
+    free(fe);
+
+    // mark blocks as allocated
+    for (int j = at; j < at + length; j++) {
+        allocator->disk_blocks[j] = 1;
+    }
+    allocator->free_blocks -= length;
+
+    extent->start_block = at;
+    extent->length = length;
+    extent->next = NULL;
+
+    return extent;
+}
+
+
+// allocate new extent: best fit from the length tree
 Extent *allocate_extent(ExtentAllocator *allocator, int desired_length) {
+    if (desired_length <= 0 || desired_length > allocator->free_blocks - allocator->reserved_blocks) return NULL;
+
+    FreeExtent *fe = best_fit(allocator, desired_length);
+    if (!fe) return NULL;
+
+    return carve_extent(allocator, fe, fe->start, desired_length);
+}
+
+
+/*
+Allocate as close to target as possible. Free extents are visited outward
+from target in order of distance, through the start-keyed tree, and the
+first one that fits is used, carving from its end nearest the target. After
+LOCALITY_PROBES extents without a fit this gives up on locality and takes
+the best fit.
+*/
+Extent *allocate_extent_near(ExtentAllocator *allocator, int desired_length, int target) {
+    if (desired_length <= 0 || desired_length > allocator->free_blocks - allocator->reserved_blocks) return NULL;
+    if (target < 0) target = 0;
+    if (target >= allocator->total_blocks) target = allocator->total_blocks - 1;
+
+    FreeExtent *left = extent_at_or_before(allocator, target);
+    FreeExtent *right = extent_at_or_after(allocator, target + 1);
+
+    for (int probe = 0; probe < LOCALITY_PROBES && (left || right); probe++) {
+        long left_distance = -1, right_distance = -1;
+        if (left) {
+            int last = left->start + left->length - 1;
+            left_distance = last >= target ? 0 : target - last;
+        }
+        if (right) right_distance = right->start - target;
+
+        if (left && (!right || left_distance <= right_distance)) {
+            if (left->length >= desired_length) {
+                int end = left->start + left->length;
+                int at = target + desired_length <= end ? target : end - desired_length;
+                return carve_extent(allocator, left, at, desired_length);
+            }
+            left = left->start > 0 ? extent_at_or_before(allocator, left->start - 1) : NULL;
+        } else {
+            if (right->length >= desired_length) {
+                return carve_extent(allocator, right, right->start, desired_length);
+            }
+            right = extent_at_or_after(allocator, right->start + 1);
+        }
+    }
+
+    return allocate_extent(allocator, desired_length);
+}
+
+
+// return an extent to free space, merging it with free neighbours on both sides
+void free_extent(ExtentAllocator *allocator, Extent *extent) {
+    int start = extent->start_block;
+    int end = start + extent->length;
+
+    for (int j = start; j < end; j++) {
+        allocator->disk_blocks[j] = 0;
+    }
+    allocator->free_blocks += extent->length;
+    free(extent);
+
+    FreeExtent *node = NULL;
+
+    FreeExtent *before = start > 0 ? extent_at_or_before(allocator, start - 1) : NULL;
+    if (before && before->start + before->length == start) {
+        free_space_remove(allocator, before);
+        start = before->start;
+        node = before;
+    }
+
+    FreeExtent *after = extent_at_or_after(allocator, end);
+    if (after && after->start == end) {
+        free_space_remove(allocator, after);
+        end = after->start + after->length;
+        if (node) free(after);
+        else node = after;
+    }
+
+    if (!node) node = malloc(sizeof(FreeExtent));
+    if (!node) return;      // space is lost from the trees but stays marked free
+
+    node->start = start;
+    node->length = end - start;
+    free_space_insert(allocator, node);
+}
+
+
+// delayed allocation: reserve space now, choose blocks when the file is flushed
+int reserve_delayed_blocks(ExtentAllocator *allocator, ExtentFile *file, int blocks) {
+    if (blocks <= 0 || blocks > allocator->free_blocks - allocator->reserved_blocks) return -1;
+
+    allocator->reserved_blocks += blocks;
+    file->delayed_blocks += blocks;
+    return 0;
+}
+
+
+static void append_extent(ExtentFile *file, Extent *extent) {
+    Extent **link = &file->extent_list;
+    Extent *tail = NULL;
+    while (*link) {
+        tail = *link;
+        link = &(*link)->next;
+    }
+
+    // continuing the previous extent on disk just makes it longer
+    if (tail && tail->start_block + tail->length == extent->start_block) {
+        tail->length += extent->length;
+        free(extent);
+        return;
+    }
+
+    *link = extent;
+    file->extent_count++;
+}
+
+
+/*
+Place a file's reserved blocks. Because the whole delayed run is known at
+once it usually lands as a single extent right after the file's last one;
+if no free extent is large enough it is split over the largest ones.
+*/
+int flush_delayed_blocks(ExtentAllocator *allocator, ExtentFile *file) {
+    int target = 0;
+    for (Extent *e = file->extent_list; e; e = e->next) {
+        target = e->start_block + e->length;
+    }
+
+    allocator->reserved_blocks -= file->delayed_blocks;
+
+    while (file->delayed_blocks > 0) {
+        int length = file->delayed_blocks;
+        FreeExtent *largest = largest_free_extent(allocator);
+        if (!largest) break;
+        if (largest->length < length) length = largest->length;
+
+        Extent *extent = allocate_extent_near(allocator, length, target);
+        if (!extent) break;
+
+        target = extent->start_block + extent->length;
+        file->delayed_blocks -= length;
+        append_extent(file, extent);
+    }
+
+    // anything left stays reserved
+    allocator->reserved_blocks += file->delayed_blocks;
+    return file->delayed_blocks == 0 ? 0 : -1;
+}
+
+
+// original linear scan over disk_blocks, kept for comparison; the run it finds
+// is carved out of the free trees like any other allocation
+Extent *allocate_extent_linear(ExtentAllocator *allocator, int desired_length) {
+    if (desired_length <= 0 || desired_length > allocator->free_blocks - allocator->reserved_blocks) return NULL;
+
     int curr_len = 0;
     int start_block = -1;
 
@@ -71,21 +492,9 @@ Extent *allocate_extent(ExtentAllocator *allocator, int desired_length) {
             curr_len++;
 
             if (curr_len == desired_length) {
-                // allocate the extent
-                Extent *extent = malloc(sizeof(Extent));
-                if (!extent) return NULL;
-
-                extent->start_block = start_block;
-                extent->length = curr_len;
-                extent->next = NULL;
-
-                // mark blocks as allocated
-                for (int j = start_block; j < start_block + curr_len; j++) {
-                    allocator->disk_blocks[j] = 1;
-                }
-                allocator->free_blocks -= curr_len;
-
-                return extent;
+                // the run lies inside the free extent that starts at or before it
+                FreeExtent *fe = extent_at_or_before(allocator, start_block);
+                return carve_extent(allocator, fe, start_block, curr_len);
             }
         }
         else {
@@ -95,3 +504,79 @@ Extent *allocate_extent(ExtentAllocator *allocator, int desired_length) {
 
     return NULL;
 }
+
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+int main() {
+    const int disk_blocks = 1 << 23;    // 8M blocks, 32 GiB at 4 KiB
+    const int live_extents = 200000;
+    const int churn_ops = 1000000;
+
+    ExtentAllocator *allocator = init_extent_allocator(disk_blocks, 16);
+    Extent **extents = calloc(live_extents, sizeof(Extent*));
+    if (!allocator || !extents) return 1;
+
+    srand(42);
+    struct timespec start, end;
+
+    // fill about 80% of the disk with 1..64-block extents
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < live_extents; i++) {
+        extents[i] = allocate_extent(allocator, 1 + rand() % 64);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%d blocks: %d initial allocations in %.1f ms\n", disk_blocks, live_extents, elapsed_ms(&start, &end));
+
+    // random free/reallocate churn, half of it with a locality hint
+    int failures = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < churn_ops; i++) {
+        int victim = rand() % live_extents;
+        int hint = extents[victim] ? extents[victim]->start_block : 0;
+        if (extents[victim]) free_extent(allocator, extents[victim]);
+
+        int length = 1 + rand() % 64;
+        extents[victim] = (i & 1) ? allocate_extent_near(allocator, length, hint)
+                                  : allocate_extent(allocator, length);
+        if (!extents[victim]) failures++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ms = elapsed_ms(&start, &end);
+    printf("%d free+allocate pairs in %.1f ms (%.0f ns/pair), %d failures, %d free extents\n",
+           churn_ops, ms, ms * 1e6 / churn_ops, failures, allocator->free_extent_count);
+
+    // delayed allocation: many small writes land as one extent at flush
+    ExtentFile *file = &allocator->files[0];
+    strcpy(file->name, "log");
+    for (int i = 0; i < 256; i++) {
+        reserve_delayed_blocks(allocator, file, 8);
+    }
+    flush_delayed_blocks(allocator, file);
+    printf("delayed file: 256 writes of 8 blocks -> %d extent(s)\n", file->extent_count);
+
+    // the old linear scan on the same fragmented disk, each extent given back after timing
+    const int linear_ops = 200;
+    Extent *linear[200];
+    int free_before = allocator->free_blocks;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < linear_ops; i++) {
+        linear[i] = allocate_extent_linear(allocator, 512);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for (int i = 0; i < linear_ops; i++) {
+        if (linear[i]) free_extent(allocator, linear[i]);
+    }
+    ms = elapsed_ms(&start, &end);
+    printf("linear scan: %d allocations of 512 blocks in %.1f ms (%.0f ns each), %d blocks leaked\n",
+           linear_ops, ms, ms * 1e6 / linear_ops, free_before - allocator->free_blocks);
+
+    for (int i = 0; i < live_extents; i++) free(extents[i]);
+    free(extents);
+    destroy_extent_allocator(allocator);
+
+    return 0;
+}
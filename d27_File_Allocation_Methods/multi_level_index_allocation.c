@@ -13,10 +13,26 @@ similar to how modern file systems like ext4 implement their inode structure.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #define BLOCK_SIZE 1024
 #define DIRECT_BLOCKS 12
-#define INDIRECT_BLOCKS ((BLOCK_SIZE - sizeof(struct MultiLevelIndex)) / sizeof(int))
+#define INDIRECT_BLOCKS (BLOCK_SIZE / sizeof(int))
+
+
+typedef struct IndirectBlock {
+    int blocks[INDIRECT_BLOCKS];
+} IndirectBlock;
+
+
+// in-memory translation cache kept with each index, zeroed means empty
+typedef struct BlockMapCache {
+    IndirectBlock *leaf;            // last indirect block that resolved a lookup
+    size_t leaf_first;              // logical block mapped by leaf->blocks[0]
+    size_t run_first;               // physically contiguous run around the last lookup
+    int run_start;
+    int run_length;
+} BlockMapCache;
 
 
 typedef struct MultiLevelIndex {
@@ -25,14 +41,10 @@ typedef struct MultiLevelIndex {
     int double_indirect;            // double indirect block pointer
     int triple_indirect;            // triple indirect block pointer
     size_t file_size;
+    BlockMapCache map_cache;        // call invalidate_block_map_cache after changing any pointer above
 } MultiLevelIndex;
 
 
-typedef struct IndirectBlock {
-    int blocks[INDIRECT_BLOCKS];
-} IndirectBlock;
-
-
 typedef struct MultiLevelAllocator {
     void *disk_blocks;
     MultiLevelIndex *idx_table;
@@ -75,47 +87,252 @@ MultiLevelAllocator *init_multilevel_allocator(int total_blocks) {
 }
 
 
+void invalidate_block_map_cache(MultiLevelIndex *idx) {
+    memset(&idx->map_cache, 0, sizeof(idx->map_cache));
+}
+
+
+// index blocks touched by find_leaf; each would be a buffer-cache lookup or disk read
+static long index_block_reads = 0;
+
+
+// walk the indirect levels down to the block holding block_num's pointer;
+// *first is set to the logical block its first entry maps
+static IndirectBlock *find_leaf(MultiLevelAllocator *allocator, MultiLevelIndex *idx,
+                                size_t block_num, size_t *first) {
+    size_t n = block_num - DIRECT_BLOCKS;
+
+    // single indirect
+    if (n < INDIRECT_BLOCKS) {
+        index_block_reads += 1;
+        *first = DIRECT_BLOCKS;
+        return &allocator->indirect_blocks[idx->single_indirect];
+    }
+
+    n -= INDIRECT_BLOCKS;
+
+    // double indirect
+    if (n < INDIRECT_BLOCKS * INDIRECT_BLOCKS) {
+        IndirectBlock *double_indirect = &allocator->indirect_blocks[idx->double_indirect];
+
+        index_block_reads += 2;
+        *first = block_num - n % INDIRECT_BLOCKS;
+        return &allocator->indirect_blocks[double_indirect->blocks[n / INDIRECT_BLOCKS]];
+    }
+
+    n -= INDIRECT_BLOCKS * INDIRECT_BLOCKS;
+
+    // triple indirect
+    if (n < INDIRECT_BLOCKS * INDIRECT_BLOCKS * INDIRECT_BLOCKS) {
+        IndirectBlock *triple_indirect = &allocator->indirect_blocks[idx->triple_indirect];
+        IndirectBlock *double_indirect =
+            &allocator->indirect_blocks[triple_indirect->blocks[n / (INDIRECT_BLOCKS * INDIRECT_BLOCKS)]];
+
+        index_block_reads += 3;
+        *first = block_num - n % INDIRECT_BLOCKS;
+        return &allocator->indirect_blocks[double_indirect->blocks[(n / INDIRECT_BLOCKS) % INDIRECT_BLOCKS]];
+    }
+
+    return NULL;
+}
+
+
 // get block address for given file offset
+// Consecutive lookups are answered from the cached run or leaf without walking the index.
 int get_block_address(MultiLevelAllocator *allocator, MultiLevelIndex *idx,
                       size_t block_num) {
     if (block_num < DIRECT_BLOCKS) {
         return idx->direct[block_num];
     }
 
-    block_num -= DIRECT_BLOCKS;
+    BlockMapCache *cache = &idx->map_cache;
 
-    // single indirect
-    if (block_num < INDIRECT_BLOCKS) {
-        IndirectBlock *indirect = &allocator->indirect_blocks[idx->single_indirect];
+    if (cache->run_length > 0 && block_num >= cache->run_first &&
+        block_num - cache->run_first < (size_t)cache->run_length) {
+        return cache->run_start + (int)(block_num - cache->run_first);
+    }
+
+    if (!cache->leaf || block_num < cache->leaf_first ||
+        block_num - cache->leaf_first >= INDIRECT_BLOCKS) {
+        size_t first;
+        IndirectBlock *leaf = find_leaf(allocator, idx, block_num, &first);
+        if (!leaf) return -1;
 
-        return indirect->blocks[block_num];
+        cache->leaf = leaf;
+        cache->leaf_first = first;
     }
 
-    block_num -= INDIRECT_BLOCKS;
+    // remember the physically contiguous run starting here, up to the end of the leaf
+    size_t from = block_num - cache->leaf_first;
+    int *entries = cache->leaf->blocks;
+    int block = entries[from];
+    size_t end = from + 1;
+    while (end < INDIRECT_BLOCKS && entries[end] == entries[end - 1] + 1) end++;
 
-    // double indirect
-    if (block_num < INDIRECT_BLOCKS * INDIRECT_BLOCKS) {
-        int indirect_idx = block_num / INDIRECT_BLOCKS;
-        int block_idx = block_num % INDIRECT_BLOCKS;
+    cache->run_first = block_num;
+    cache->run_start = block;
+    cache->run_length = (int)(end - from);
 
-        IndirectBlock *double_indirect = &allocator->indirect_blocks[idx->double_indirect];
-        IndirectBlock *indirect = &allocator->indirect_blocks[double_indirect->blocks[indirect_idx]];
+    return block;
+}
 
-        return indirect->blocks[block_idx];
+
+/*
+Map every block touched by the byte range [offset, offset + length) into
+blocks[], walking the index once per leaf instead of once per block.
+Returns the number of blocks stored, or -1 if the range needs more than
+max_blocks entries or runs past what the index can address.
+*/
+int get_block_range(MultiLevelAllocator *allocator, MultiLevelIndex *idx,
+                    size_t offset, size_t length, int *blocks, size_t max_blocks) {
+    if (length == 0) return 0;
+
+    size_t block_num = offset / BLOCK_SIZE;
+    size_t last = (offset + length - 1) / BLOCK_SIZE;
+    if (last - block_num + 1 > max_blocks) return -1;
+
+    int count = 0;
+
+    while (block_num <= last && block_num < DIRECT_BLOCKS) {
+        blocks[count++] = idx->direct[block_num++];
     }
 
-    block_num -= INDIRECT_BLOCKS;
+    while (block_num <= last) {
+        size_t first;
+        IndirectBlock *leaf = find_leaf(allocator, idx, block_num, &first);
+        if (!leaf) return -1;
 
-    // triple indirect
-    if (block_num < INDIRECT_BLOCKS * INDIRECT_BLOCKS * INDIRECT_BLOCKS) {
-        int indirect_idx = block_num / INDIRECT_BLOCKS / INDIRECT_BLOCKS;
-        int block_idx = block_num % INDIRECT_BLOCKS % INDIRECT_BLOCKS;
+        size_t from = block_num - first;
+        size_t n = INDIRECT_BLOCKS - from;
+        if (n > last - block_num + 1) n = last - block_num + 1;
 
-        IndirectBlock *triple_indirect = &allocator->indirect_blocks[idx->triple_indirect];
-        IndirectBlock *indirect = &allocator->indirect_blocks[triple_indirect->blocks[indirect_idx]];
-    
-        return indirect->blocks[block_idx];
+        memcpy(&blocks[count], &leaf->blocks[from], n * sizeof(int));
+        count += n;
+        block_num += n;
+
+        idx->map_cache.leaf = leaf;
+        idx->map_cache.leaf_first = first;
+    }
+
+    return count;
+}
+
+
+// lay out a file of file_blocks contiguous data blocks, allocating indirect blocks as needed
+static int next_indirect = 0;
+
+static int new_indirect(MultiLevelAllocator *allocator) {
+    memset(&allocator->indirect_blocks[next_indirect], 0, sizeof(IndirectBlock));
+    return next_indirect++;
+}
+
+
+static void build_file(MultiLevelAllocator *allocator, MultiLevelIndex *idx, size_t file_blocks) {
+    memset(idx, 0, sizeof(MultiLevelIndex));
+    idx->single_indirect = new_indirect(allocator);
+    idx->double_indirect = new_indirect(allocator);
+    idx->triple_indirect = new_indirect(allocator);
+
+    for (size_t b = 0; b < file_blocks; b++) {
+        int block = allocator->free_list[b];
+
+        if (b < DIRECT_BLOCKS) {
+            idx->direct[b] = block;
+            continue;
+        }
+
+        size_t first;
+        size_t n = b - DIRECT_BLOCKS;
+        if (n >= INDIRECT_BLOCKS + INDIRECT_BLOCKS * INDIRECT_BLOCKS) {
+            // make sure the triple path exists before resolving through it
+            n -= INDIRECT_BLOCKS + INDIRECT_BLOCKS * INDIRECT_BLOCKS;
+            IndirectBlock *triple = &allocator->indirect_blocks[idx->triple_indirect];
+            int *mid = &triple->blocks[n / (INDIRECT_BLOCKS * INDIRECT_BLOCKS)];
+            if (n % (INDIRECT_BLOCKS * INDIRECT_BLOCKS) == 0) *mid = new_indirect(allocator);
+            int *leaf = &allocator->indirect_blocks[*mid].blocks[(n / INDIRECT_BLOCKS) % INDIRECT_BLOCKS];
+            if (n % INDIRECT_BLOCKS == 0) *leaf = new_indirect(allocator);
+        } else if (n >= INDIRECT_BLOCKS) {
+            n -= INDIRECT_BLOCKS;
+            int *leaf = &allocator->indirect_blocks[idx->double_indirect].blocks[n / INDIRECT_BLOCKS];
+            if (n % INDIRECT_BLOCKS == 0) *leaf = new_indirect(allocator);
+        }
+
+        IndirectBlock *leaf = find_leaf(allocator, idx, b, &first);
+        leaf->blocks[b - first] = block;
     }
 
-    return -1;
+    idx->file_size = file_blocks * BLOCK_SIZE;
+}
+
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+
+int main() {
+    // past the double-indirect range, so the triple path is exercised
+    const size_t file_blocks = 200000;
+    MultiLevelAllocator *allocator = init_multilevel_allocator(262144);
+    if (!allocator) return 1;
+
+    MultiLevelIndex *idx = &allocator->idx_table[0];
+    build_file(allocator, idx, file_blocks);
+
+    struct timespec start, end;
+    long sum = 0;
+    int mismatches = 0;
+
+    // uncached: full walk per block
+    index_block_reads = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t b = DIRECT_BLOCKS; b < file_blocks; b++) {
+        size_t first;
+        sum += find_leaf(allocator, idx, b, &first)->blocks[b - first];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("walk per block:     %5.1f ns/block, %7ld index block reads\n",
+           elapsed_ns(&start, &end) / file_blocks, index_block_reads);
+
+    // cached sequential lookups
+    int *blocks = malloc(file_blocks * sizeof(int));
+    if (!blocks) return 1;
+    memset(blocks, 0, file_blocks * sizeof(int));
+
+    invalidate_block_map_cache(idx);
+    index_block_reads = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t b = 0; b < file_blocks; b++) {
+        blocks[b] = get_block_address(allocator, idx, b);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("get_block_address:  %5.1f ns/block, %7ld index block reads\n",
+           elapsed_ns(&start, &end) / file_blocks, index_block_reads);
+
+    for (size_t b = 0; b < file_blocks; b++) {
+        if (blocks[b] != allocator->free_list[b]) mismatches++;
+    }
+
+    // whole file in one batched call
+    memset(blocks, 0, file_blocks * sizeof(int));
+    index_block_reads = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int count = get_block_range(allocator, idx, 0, idx->file_size, blocks, file_blocks);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("get_block_range:    %5.1f ns/block, %7ld index block reads (%d blocks)\n",
+           elapsed_ns(&start, &end) / file_blocks, index_block_reads, count);
+
+    for (int i = 0; i < count; i++) {
+        if (blocks[i] != allocator->free_list[i]) mismatches++;
+    }
+    printf("mismatches: %d (checksum %ld)\n", mismatches, sum);
+
+    free(blocks);
+    free(allocator->disk_blocks);
+    free(allocator->idx_table);
+    free(allocator->indirect_blocks);
+    free(allocator->free_list);
+    free(allocator);
+
+    return 0;
 }
@@ -11,148 +11,801 @@ Modern systems often use predictive algorithms to optimize block placement and a
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 
 #define MAX_PREFETCH 256
+#define PREFETCH_QUEUE_SIZE 1024        // ring slots, power of two
+
+// heat decays by DECAY_FACTOR per access, applied lazily when a block is touched
+#define DECAY_FACTOR 0.95
+#define HOT_BLOCKS 16                   // size of the top-K heat heap
+#define HOT_THRESHOLD 2.0               // heat a block needs before it is prefetched as hot
+
+// stream detector
+#define MAX_STREAMS 8                   // concurrently tracked access streams
+#define STREAM_RADIUS 256               // max distance for an access to train a stream
+#define MAX_CONFIDENCE 4
+
+// accuracy feedback on prefetch_window_size
+#define ADAPT_INTERVAL 64               // prefetches issued between window adjustments
+#define WIDEN_ACCURACY 0.75
+#define SHRINK_ACCURACY 0.40
+#define PREFETCH_HORIZON 1024           // accesses after which an unused prefetch counts as wasted
+
+// block cache filled by the prefetch workers
+#define BLOCK_SIZE 4096
+#define CACHE_SLOTS 4096                // direct-mapped on block number
+#define MAX_WORKERS 16
+
+// per-block prefetch state, used to deduplicate and cancel requests
+#define BLOCK_IDLE 0
+#define BLOCK_QUEUED 1
+#define BLOCK_LOADING 2
+
+
+typedef struct AccessStream {
+    int last_block;
+    int stride;                         // 0 until a second nearby access trains it
+    int confidence;                     // consecutive accesses that matched the stride
+    int ahead;                          // strides past last_block already prefetched
+    unsigned long last_used;
+} AccessStream;
+
+
+// heap key is log(heat) + decay_rate * stamp: it orders blocks by current heat
+// and does not change as time passes, so only touched blocks need re-keying
+typedef struct HotEntry {
+    int block;
+    double key;
+} HotEntry;
+
+
+/*
+Prefetch requests travel through a bounded multi-producer/multi-consumer ring
+(Vyukov style): each slot carries a sequence number that tells producers and
+consumers whose turn it is, so neither side takes a lock. When the ring is
+full the producer pops the oldest request itself, which keeps the old
+drop-oldest behaviour.
+*/
+typedef struct PrefetchRequest {
+    atomic_ulong sequence;
+    int block;
+    unsigned long tick;                 // access tick when the request was issued
+} PrefetchRequest;
+
+
+typedef struct CacheSlot {
+    pthread_mutex_t lock;
+    int block;                          // -1 when empty
+    int prefetched;                     // filled by a worker and not read yet
+    char *data;
+} CacheSlot;
+
+
+typedef struct PrefetchStats {
+    atomic_long completed;              // prefetch reads that reached the cache
+    atomic_long cancelled;              // stale, or the demand read got there first
+    atomic_long dropped;                // pushed out of a full queue
+    atomic_long deduplicated;           // already queued, in flight or cached
+    atomic_long used;                   // prefetched blocks later read by the application
+    atomic_long wasted;                 // prefetched blocks evicted or left unread
+    atomic_long demand_hits;
+    atomic_long demand_misses;
+} PrefetchStats;
 
 
 typedef struct PerformanceOptimizer {
     struct {
-        int *blocks;
-        int count;
-        int capacity;
+        PrefetchRequest *slots;
+        atomic_ulong head;              // next slot to consume
+        atomic_ulong tail;              // next slot to fill
+        unsigned long mask;
     } prefetch_queue;
 
+    // background executor: workers read queued blocks from fd into cache
+    struct {
+        pthread_t workers[MAX_WORKERS];
+        int worker_count;
+        int fd;
+        sem_t pending;
+        atomic_int stop;
+        atomic_ulong published_tick;    // producer's tick, read by workers to spot stale requests
+        atomic_uchar *block_state;
+        CacheSlot *cache;
+        PrefetchStats stats;
+    } executor;
+
     struct {
         int *block_access_count;
-        int *block_access_pattern;
-        double *block_heat_map;
+        int *block_access_pattern;      // stream index that last touched the block
+        double *block_heat_map;         // heat as of block_heat_stamp
+        unsigned long *block_heat_stamp;
+        unsigned long *prefetch_stamp;  // when the block was prefetched, 0 if not pending
     } metrics;
 
+    struct {
+        HotEntry heap[HOT_BLOCKS];      // min-heap on key, root is the coolest hot block
+        int count;
+        int *position;                  // heap index per block, -1 if absent
+    } hot;
+
+    AccessStream streams[MAX_STREAMS];
+    int stream_count;
+
+    struct {
+        long issued;
+        long useful;
+        long window_issued;
+        long window_useful;
+    } feedback;
+
+    unsigned long tick;
     int total_blocks;
     int prefetch_window_size;
 } PerformanceOptimizer;
 
 
-int predict_next_blocks(PerformanceOptimizer *optimizer, int block_num, int predict_blocks[]);
+int predict_next_blocks(PerformanceOptimizer *optimizer, AccessStream *stream, int block_num, int predict_blocks[]);
 void queue_prefetch(PerformanceOptimizer *optimizer, int predict_block);
 
 
+void stop_prefetch_workers(PerformanceOptimizer *optimizer);
+
+
+void destroy_performance_optimizer(PerformanceOptimizer *optimizer) {
+    if (!optimizer) return;
+
+    stop_prefetch_workers(optimizer);
+    if (optimizer->executor.cache) {
+        for (int i = 0; i < CACHE_SLOTS; i++) {
+            pthread_mutex_destroy(&optimizer->executor.cache[i].lock);
+            free(optimizer->executor.cache[i].data);
+        }
+        free(optimizer->executor.cache);
+    }
+
+    free(optimizer->prefetch_queue.slots);
+    free(optimizer->executor.block_state);
+    free(optimizer->metrics.block_access_count);
+    free(optimizer->metrics.block_access_pattern);
+    free(optimizer->metrics.block_heat_map);
+    free(optimizer->metrics.block_heat_stamp);
+    free(optimizer->metrics.prefetch_stamp);
+    free(optimizer->hot.position);
+    free(optimizer);
+}
+
+
 PerformanceOptimizer *init_performance_optimizer(int total_blocks, int prefetch_size) {
-    PerformanceOptimizer *optimizer = malloc(sizeof(PerformanceOptimizer));
+    PerformanceOptimizer *optimizer = calloc(1, sizeof(PerformanceOptimizer));
     if (!optimizer) return NULL;
 
-    optimizer->prefetch_queue.blocks = malloc(prefetch_size * sizeof(int));
+    optimizer->prefetch_queue.slots = malloc(PREFETCH_QUEUE_SIZE * sizeof(PrefetchRequest));
+    optimizer->executor.block_state = calloc(total_blocks, sizeof(atomic_uchar));
     optimizer->metrics.block_access_count = calloc(total_blocks, sizeof(int));
     optimizer->metrics.block_access_pattern = calloc(total_blocks, sizeof(int));
     optimizer->metrics.block_heat_map = calloc(total_blocks, sizeof(double));
+    optimizer->metrics.block_heat_stamp = calloc(total_blocks, sizeof(unsigned long));
+    optimizer->metrics.prefetch_stamp = calloc(total_blocks, sizeof(unsigned long));
+    optimizer->hot.position = malloc(total_blocks * sizeof(int));
 
-    if (!optimizer->prefetch_queue.blocks ||
+    if (!optimizer->prefetch_queue.slots ||
+        !optimizer->executor.block_state ||
         !optimizer->metrics.block_access_count ||
         !optimizer->metrics.block_access_pattern ||
-        !optimizer->metrics.block_heat_map) {
-        
-        if (optimizer->prefetch_queue.blocks) free(optimizer->prefetch_queue.blocks);
-        if (optimizer->metrics.block_access_count) free(optimizer->metrics.block_access_count);
-        if (optimizer->metrics.block_access_pattern) free(optimizer->metrics.block_access_pattern);
-        if (optimizer->metrics.block_heat_map) free(optimizer->metrics.block_heat_map);
-        free(optimizer);
+        !optimizer->metrics.block_heat_map ||
+        !optimizer->metrics.block_heat_stamp ||
+        !optimizer->metrics.prefetch_stamp ||
+        !optimizer->hot.position) {
 
+        destroy_performance_optimizer(optimizer);
         return NULL;
     }
 
-    optimizer->prefetch_queue.count = 0;
-    optimizer->prefetch_queue.capacity = prefetch_size;
+    for (int i = 0; i < total_blocks; i++) {
+        optimizer->hot.position[i] = -1;
+    }
+
+    for (int i = 0; i < PREFETCH_QUEUE_SIZE; i++) {
+        atomic_init(&optimizer->prefetch_queue.slots[i].sequence, i);
+    }
+    atomic_init(&optimizer->prefetch_queue.head, 0);
+    atomic_init(&optimizer->prefetch_queue.tail, 0);
+    optimizer->prefetch_queue.mask = PREFETCH_QUEUE_SIZE - 1;
+    optimizer->executor.fd = -1;
     optimizer->total_blocks = total_blocks;
-    optimizer->prefetch_window_size = prefetch_size;
+    optimizer->prefetch_window_size = prefetch_size < MAX_PREFETCH ? prefetch_size : MAX_PREFETCH;
+    if (optimizer->prefetch_window_size < 1) optimizer->prefetch_window_size = 1;
+    optimizer->tick = 1;                // 0 is reserved for "never"
 
     return optimizer;
 }
 
 
+static void hot_swap(PerformanceOptimizer *optimizer, int a, int b) {
+    HotEntry tmp = optimizer->hot.heap[a];
+    optimizer->hot.heap[a] = optimizer->hot.heap[b];
+    optimizer->hot.heap[b] = tmp;
+    optimizer->hot.position[optimizer->hot.heap[a].block] = a;
+    optimizer->hot.position[optimizer->hot.heap[b].block] = b;
+}
+
+
+static void hot_sift_up(PerformanceOptimizer *optimizer, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (optimizer->hot.heap[parent].key <= optimizer->hot.heap[i].key) break;
+        hot_swap(optimizer, i, parent);
+        i = parent;
+    }
+}
+
+
+static void hot_sift_down(PerformanceOptimizer *optimizer, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < optimizer->hot.count &&
+            optimizer->hot.heap[left].key < optimizer->hot.heap[smallest].key) smallest = left;
+        if (right < optimizer->hot.count &&
+            optimizer->hot.heap[right].key < optimizer->hot.heap[smallest].key) smallest = right;
+        if (smallest == i) break;
+
+        hot_swap(optimizer, i, smallest);
+        i = smallest;
+    }
+}
+
+
+// apply the decay owed since the block was last touched, add this access and
+// re-rank it against the top-K; O(log K) instead of decaying every block
+static void update_heat(PerformanceOptimizer *optimizer, int block_num) {
+    const double decay_rate = -log(DECAY_FACTOR);
+    unsigned long elapsed = optimizer->tick - optimizer->metrics.block_heat_stamp[block_num];
+
+    double heat = optimizer->metrics.block_heat_map[block_num] * exp(-decay_rate * (double)elapsed) + 1.0;
+    optimizer->metrics.block_heat_map[block_num] = heat;
+    optimizer->metrics.block_heat_stamp[block_num] = optimizer->tick;
+
+    double key = log(heat) + decay_rate * (double)optimizer->tick;
+    int pos = optimizer->hot.position[block_num];
+
+    if (pos >= 0) {
+        // heat only grows on access, so the entry can only move down a min-heap
+        optimizer->hot.heap[pos].key = key;
+        hot_sift_down(optimizer, pos);
+    } else if (optimizer->hot.count < HOT_BLOCKS) {
+        pos = optimizer->hot.count++;
+        optimizer->hot.heap[pos].block = block_num;
+        optimizer->hot.heap[pos].key = key;
+        optimizer->hot.position[block_num] = pos;
+        hot_sift_up(optimizer, pos);
+    } else if (key > optimizer->hot.heap[0].key) {
+        optimizer->hot.position[optimizer->hot.heap[0].block] = -1;
+        optimizer->hot.heap[0].block = block_num;
+        optimizer->hot.heap[0].key = key;
+        optimizer->hot.position[block_num] = 0;
+        hot_sift_down(optimizer, 0);
+    }
+}
+
+
+/*
+Finds the stream an access belongs to. An access that lands exactly one
+stride past a trained stream continues it; otherwise the nearest stream
+within STREAM_RADIUS is retrained with the new stride (this covers forward,
+backward and fixed-stride scans); otherwise the least recently used slot
+starts a new stream. Exact stride matches are checked first so interleaved
+streams that sit close together do not steal each other's accesses.
+*/
+static AccessStream *match_stream(PerformanceOptimizer *optimizer, int block_num) {
+    AccessStream *nearest = NULL;
+    int nearest_distance = STREAM_RADIUS + 1;
+
+    for (int i = 0; i < optimizer->stream_count; i++) {
+        AccessStream *s = &optimizer->streams[i];
+        if (s->stride != 0 && block_num == s->last_block + s->stride) {
+            if (s->confidence < MAX_CONFIDENCE) s->confidence++;
+            if (s->ahead > 0) s->ahead--;
+            return s;
+        }
+    }
+
+    for (int i = 0; i < optimizer->stream_count; i++) {
+        AccessStream *s = &optimizer->streams[i];
+        if (block_num == s->last_block) return s;       // re-read, nothing learned
+
+        int distance = abs(block_num - s->last_block);
+        if (distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest = s;
+        }
+    }
+
+    if (nearest) {
+        nearest->stride = block_num - nearest->last_block;
+        nearest->confidence = 0;
+        nearest->ahead = 0;
+        return nearest;
+    }
+
+    AccessStream *victim;
+    if (optimizer->stream_count < MAX_STREAMS) {
+        victim = &optimizer->streams[optimizer->stream_count++];
+    } else {
+        victim = &optimizer->streams[0];
+        for (int i = 1; i < MAX_STREAMS; i++) {
+            if (optimizer->streams[i].last_used < victim->last_used) {
+                victim = &optimizer->streams[i];
+            }
+        }
+    }
+
+    victim->stride = 0;
+    victim->confidence = 0;
+    victim->ahead = 0;
+    return victim;
+}
+
+
+// widen the window while prefetches keep getting used, shrink it when they are wasted
+static void adapt_window(PerformanceOptimizer *optimizer) {
+    if (optimizer->feedback.window_issued < ADAPT_INTERVAL) return;
+
+    double accuracy = (double)optimizer->feedback.window_useful / optimizer->feedback.window_issued;
+
+    if (accuracy >= WIDEN_ACCURACY && optimizer->prefetch_window_size < MAX_PREFETCH / 2) {
+        optimizer->prefetch_window_size *= 2;
+    } else if (accuracy < SHRINK_ACCURACY && optimizer->prefetch_window_size > 1) {
+        optimizer->prefetch_window_size /= 2;
+    }
+
+    optimizer->feedback.window_issued = 0;
+    optimizer->feedback.window_useful = 0;
+}
+
+
+static int prefetch_pending(PerformanceOptimizer *optimizer, int block_num) {
+    unsigned long stamp = optimizer->metrics.prefetch_stamp[block_num];
+    return stamp != 0 && optimizer->tick - stamp <= PREFETCH_HORIZON;
+}
+
+
 // update access patterns and trigger prefech
 void update_access_pattern(PerformanceOptimizer *optimizer, int block_num) {
+    if (block_num < 0 || block_num >= optimizer->total_blocks) return;
+
+    optimizer->tick++;
+    atomic_store_explicit(&optimizer->executor.published_tick, optimizer->tick, memory_order_relaxed);
+
     // update access count
     optimizer->metrics.block_access_count[block_num]++;
 
-    // update heat map with decay
-    const double decay_fator = 0.95;
-
-    for (int i = 0; i < optimizer->total_blocks; i++) {
-        optimizer->metrics.block_heat_map[i] *= decay_fator;
+    // credit the prefetch that brought this block in
+    if (prefetch_pending(optimizer, block_num)) {
+        optimizer->feedback.useful++;
+        optimizer->feedback.window_useful++;
     }
-    optimizer->metrics.block_heat_map[block_num] += 1.0;
+    optimizer->metrics.prefetch_stamp[block_num] = 0;
+
+    update_heat(optimizer, block_num);
+
+    AccessStream *stream = match_stream(optimizer, block_num);
+    stream->last_block = block_num;
+    stream->last_used = optimizer->tick;
+    optimizer->metrics.block_access_pattern[block_num] = (int)(stream - optimizer->streams);
 
     // predict next blocks to prefech
-    int predict_blocks[MAX_PREFETCH];
-    int predict_count = predict_next_blocks(optimizer, block_num, predict_blocks);
+    int predict_blocks[MAX_PREFETCH + 1];
+    int predict_count = predict_next_blocks(optimizer, stream, block_num, predict_blocks);
 
     // queue prefetch operations
     for (int i = 0; i < predict_count; i++) {
         queue_prefetch(optimizer, predict_blocks[i]);
     }
+
+    adapt_window(optimizer);
 }
 
-// Uses a simple sequential prediction (block_num+1, +2, …) and adds a hot block from the heat map.
-int predict_next_blocks(PerformanceOptimizer *optimizer, int block_num, int predict_blocks[]) {
+// Follows the stream's stride for prefetch_window_size blocks once it is confirmed, and adds the hottest block.
+// The stream remembers how far ahead it has issued, so a steady stream only issues the block entering the window.
+int predict_next_blocks(PerformanceOptimizer *optimizer, AccessStream *stream, int block_num, int predict_blocks[]) {
     int count = 0;
 
-    // predict sequential next few blocks
-    for (int i = 1; i <= optimizer->prefetch_window_size; i++) {
-        int next_block = block_num + i;
-        if (next_block < optimizer->total_blocks) {
-            predict_blocks[count++] = next_block;
+    if (stream->stride != 0 && stream->confidence > 0) {
+        for (int i = stream->ahead + 1; i <= optimizer->prefetch_window_size; i++) {
+            long next_block = block_num + (long)stream->stride * i;
+            if (next_block < 0 || next_block >= optimizer->total_blocks) break;
+
+            stream->ahead = i;
+            if (prefetch_pending(optimizer, (int)next_block)) continue;
+            predict_blocks[count++] = (int)next_block;
         }
     }
 
-    // optional: include a "hot" block based on heat map (skipping already predicted)
-    double max_heat = 0.0;
+    // include the hottest block unless it is the current one or already on its way
     int hot_block = -1;
-    for (int i = 0; i < optimizer->total_blocks; i++) {
-        if (i == block_num) continue;
-        if (optimizer->metrics.block_heat_map[i] > max_heat) {
-            max_heat = optimizer->metrics.block_heat_map[i];
-            hot_block = i;
+    double max_key = -INFINITY;
+    for (int i = 0; i < optimizer->hot.count; i++) {
+        if (optimizer->hot.heap[i].block == block_num) continue;
+        if (optimizer->hot.heap[i].key > max_key) {
+            max_key = optimizer->hot.heap[i].key;
+            hot_block = optimizer->hot.heap[i].block;
         }
     }
 
-    if (hot_block >= 0 && count < MAX_PREFETCH) {
+    // a block touched once is not hot, it is just recent
+    const double decay_rate = -log(DECAY_FACTOR);
+    double heat = exp(max_key - decay_rate * (double)optimizer->tick);
+
+    if (hot_block >= 0 && heat >= HOT_THRESHOLD &&
+        !prefetch_pending(optimizer, hot_block) && count <= MAX_PREFETCH) {
         predict_blocks[count++] = hot_block;
     }
 
     return count;
 }
 
-// Keeps a FIFO prefetch queue of limited size (MAX_PREFETCH), dropping the oldest entries when full.
+static int ring_push(PerformanceOptimizer *optimizer, int block, unsigned long tick) {
+    unsigned long pos = atomic_load_explicit(&optimizer->prefetch_queue.tail, memory_order_relaxed);
+
+    for (;;) {
+        PrefetchRequest *slot = &optimizer->prefetch_queue.slots[pos & optimizer->prefetch_queue.mask];
+        unsigned long seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        long diff = (long)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&optimizer->prefetch_queue.tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                slot->block = block;
+                slot->tick = tick;
+                atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;                   // full
+        } else {
+            pos = atomic_load_explicit(&optimizer->prefetch_queue.tail, memory_order_relaxed);
+        }
+    }
+}
+
+
+static int ring_pop(PerformanceOptimizer *optimizer, int *block, unsigned long *tick) {
+    unsigned long pos = atomic_load_explicit(&optimizer->prefetch_queue.head, memory_order_relaxed);
+
+    for (;;) {
+        PrefetchRequest *slot = &optimizer->prefetch_queue.slots[pos & optimizer->prefetch_queue.mask];
+        unsigned long seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        long diff = (long)(seq - (pos + 1));
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&optimizer->prefetch_queue.head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *block = slot->block;
+                *tick = slot->tick;
+                atomic_store_explicit(&slot->sequence, pos + optimizer->prefetch_queue.mask + 1,
+                                      memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;                   // empty
+        } else {
+            pos = atomic_load_explicit(&optimizer->prefetch_queue.head, memory_order_relaxed);
+        }
+    }
+}
+
+
+// take a queued block back to idle; fails if a worker already started loading it
+static int cancel_prefetch(PerformanceOptimizer *optimizer, int block) {
+    unsigned char expected = BLOCK_QUEUED;
+    return atomic_compare_exchange_strong(&optimizer->executor.block_state[block], &expected, BLOCK_IDLE);
+}
+
+
+static int cache_contains(PerformanceOptimizer *optimizer, int block) {
+    if (!optimizer->executor.cache) return 0;
+
+    CacheSlot *slot = &optimizer->executor.cache[block % CACHE_SLOTS];
+    pthread_mutex_lock(&slot->lock);
+    int found = slot->block == block;
+    pthread_mutex_unlock(&slot->lock);
+    return found;
+}
+
+
+// Pushes onto the lock-free ring, dropping the oldest request when it is full.
+// Blocks that are already queued, loading or cached are not queued again.
 void queue_prefetch(PerformanceOptimizer *optimizer, int predict_block) {
-    if (optimizer->prefetch_queue.count >= optimizer->prefetch_queue.capacity) {
-        // drop oldest
-        memmove(&optimizer->prefetch_queue.blocks[0],
-                &optimizer->prefetch_queue.blocks[1],
-                (optimizer->prefetch_queue.capacity - 1) * sizeof(int));
-        optimizer->prefetch_queue.count = optimizer->prefetch_queue.capacity - 1;
+    unsigned char expected = BLOCK_IDLE;
+
+    if (cache_contains(optimizer, predict_block) ||
+        !atomic_compare_exchange_strong(&optimizer->executor.block_state[predict_block], &expected, BLOCK_QUEUED)) {
+        atomic_fetch_add_explicit(&optimizer->executor.stats.deduplicated, 1, memory_order_relaxed);
+        return;
+    }
+
+    while (!ring_push(optimizer, predict_block, optimizer->tick)) {
+        int oldest;
+        unsigned long issued;
+        if (ring_pop(optimizer, &oldest, &issued) && cancel_prefetch(optimizer, oldest)) {
+            atomic_fetch_add_explicit(&optimizer->executor.stats.dropped, 1, memory_order_relaxed);
+        }
+    }
+
+    optimizer->metrics.prefetch_stamp[predict_block] = optimizer->tick;
+    optimizer->feedback.issued++;
+    optimizer->feedback.window_issued++;
+
+    if (optimizer->executor.worker_count > 0) {
+        sem_post(&optimizer->executor.pending);
+    }
+}
+
+
+// copy a block into the cache; an unread prefetched block it replaces is wasted
+static void cache_install(PerformanceOptimizer *optimizer, int block, const char *data, int prefetched) {
+    CacheSlot *slot = &optimizer->executor.cache[block % CACHE_SLOTS];
+
+    pthread_mutex_lock(&slot->lock);
+    if (slot->block == block) {
+        // the demand path loaded it while the prefetch was in flight
+        pthread_mutex_unlock(&slot->lock);
+        return;
+    }
+    if (slot->block >= 0 && slot->prefetched) {
+        atomic_fetch_add_explicit(&optimizer->executor.stats.wasted, 1, memory_order_relaxed);
+    }
+    memcpy(slot->data, data, BLOCK_SIZE);
+    slot->block = block;
+    slot->prefetched = prefetched;
+    pthread_mutex_unlock(&slot->lock);
+}
+
+
+static void *prefetch_worker(void *arg) {
+    PerformanceOptimizer *optimizer = arg;
+    char buffer[BLOCK_SIZE];
+
+    for (;;) {
+        sem_wait(&optimizer->executor.pending);
+        if (atomic_load(&optimizer->executor.stop)) break;
+
+        int block;
+        unsigned long issued;
+        if (!ring_pop(optimizer, &block, &issued)) continue;    // producer dropped it
+
+        // requests the access stream has long moved past are not worth the I/O
+        unsigned long now = atomic_load_explicit(&optimizer->executor.published_tick, memory_order_relaxed);
+        if (now - issued > PREFETCH_HORIZON) {
+            if (cancel_prefetch(optimizer, block)) {
+                atomic_fetch_add_explicit(&optimizer->executor.stats.cancelled, 1, memory_order_relaxed);
+            }
+            continue;
+        }
+
+        unsigned char expected = BLOCK_QUEUED;
+        if (!atomic_compare_exchange_strong(&optimizer->executor.block_state[block], &expected, BLOCK_LOADING)) {
+            atomic_fetch_add_explicit(&optimizer->executor.stats.cancelled, 1, memory_order_relaxed);
+            continue;
+        }
+
+        if (pread(optimizer->executor.fd, buffer, BLOCK_SIZE, (off_t)block * BLOCK_SIZE) == BLOCK_SIZE) {
+            cache_install(optimizer, block, buffer, 1);
+            atomic_fetch_add_explicit(&optimizer->executor.stats.completed, 1, memory_order_relaxed);
+        }
+        atomic_store(&optimizer->executor.block_state[block], BLOCK_IDLE);
+    }
+
+    return NULL;
+}
+
+
+// start worker_count threads that serve the prefetch queue from fd
+int start_prefetch_workers(PerformanceOptimizer *optimizer, int fd, int worker_count) {
+    if (worker_count < 1 || worker_count > MAX_WORKERS) return -1;
+
+    optimizer->executor.cache = calloc(CACHE_SLOTS, sizeof(CacheSlot));
+    if (!optimizer->executor.cache) return -1;
+
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        pthread_mutex_init(&optimizer->executor.cache[i].lock, NULL);
+        optimizer->executor.cache[i].block = -1;
+        optimizer->executor.cache[i].data = malloc(BLOCK_SIZE);
+        if (!optimizer->executor.cache[i].data) return -1;
+    }
+
+    optimizer->executor.fd = fd;
+    atomic_store(&optimizer->executor.stop, 0);
+    sem_init(&optimizer->executor.pending, 0, 0);
+
+    for (int i = 0; i < worker_count; i++) {
+        if (pthread_create(&optimizer->executor.workers[i], NULL, prefetch_worker, optimizer) != 0) break;
+        optimizer->executor.worker_count++;
+    }
+
+    return optimizer->executor.worker_count > 0 ? 0 : -1;
+}
+
+
+// join the workers; prefetched blocks still unread in the cache count as wasted
+void stop_prefetch_workers(PerformanceOptimizer *optimizer) {
+    if (optimizer->executor.worker_count == 0) return;
+
+    atomic_store(&optimizer->executor.stop, 1);
+    for (int i = 0; i < optimizer->executor.worker_count; i++) {
+        sem_post(&optimizer->executor.pending);
+    }
+    for (int i = 0; i < optimizer->executor.worker_count; i++) {
+        pthread_join(optimizer->executor.workers[i], NULL);
+    }
+    optimizer->executor.worker_count = 0;
+    sem_destroy(&optimizer->executor.pending);
+
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        if (optimizer->executor.cache[i].block >= 0 && optimizer->executor.cache[i].prefetched) {
+            optimizer->executor.cache[i].prefetched = 0;
+            atomic_fetch_add(&optimizer->executor.stats.wasted, 1);
+        }
+    }
+}
+
+
+// application read: served from the cache when a prefetch got there first
+ssize_t optimizer_read_block(PerformanceOptimizer *optimizer, int block_num, void *buffer) {
+    if (block_num < 0 || block_num >= optimizer->total_blocks || !optimizer->executor.cache) return -1;
+
+    CacheSlot *slot = &optimizer->executor.cache[block_num % CACHE_SLOTS];
+    int hit = 0;
+
+    pthread_mutex_lock(&slot->lock);
+    if (slot->block == block_num) {
+        memcpy(buffer, slot->data, BLOCK_SIZE);
+        if (slot->prefetched) {
+            slot->prefetched = 0;
+            atomic_fetch_add_explicit(&optimizer->executor.stats.used, 1, memory_order_relaxed);
+        }
+        hit = 1;
     }
+    pthread_mutex_unlock(&slot->lock);
 
-    optimizer->prefetch_queue.blocks[optimizer->prefetch_queue.count++] = predict_block;
+    if (hit) {
+        atomic_fetch_add_explicit(&optimizer->executor.stats.demand_hits, 1, memory_order_relaxed);
+    } else {
+        // nobody should fetch this block in the background any more
+        cancel_prefetch(optimizer, block_num);
+
+        if (pread(optimizer->executor.fd, buffer, BLOCK_SIZE, (off_t)block_num * BLOCK_SIZE) != BLOCK_SIZE) {
+            return -1;
+        }
+        cache_install(optimizer, block_num, buffer, 0);
+        atomic_fetch_add_explicit(&optimizer->executor.stats.demand_misses, 1, memory_order_relaxed);
+    }
+
+    update_access_pattern(optimizer, block_num);
+    return BLOCK_SIZE;
+}
+
+
+// run one access pattern and report accuracy, final window and cost per access
+static void run_pattern(const char *name, int total_blocks, int accesses, int (*next)(int i)) {
+    PerformanceOptimizer *opt = init_performance_optimizer(total_blocks, 4);
+    if (!opt) return;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < accesses; i++) {
+        update_access_pattern(opt, next(i));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / accesses;
+    double accuracy = opt->feedback.issued ? (double)opt->feedback.useful / opt->feedback.issued : 0.0;
+
+    printf("%-22s issued %7ld, used %7ld (%5.1f%%), window %3d, %6.1f ns/access\n",
+           name, opt->feedback.issued, opt->feedback.useful, accuracy * 100.0,
+           opt->prefetch_window_size, ns);
+
+    destroy_performance_optimizer(opt);
+}
+
+
+static int sequential(int i) { return i; }
+static int backward(int i) { return 999999 - i; }
+static int strided(int i) { return (i * 8) % 1000000; }
+static int interleaved(int i) { return (i % 3) * 300000 + i / 3; }
+static int random_blocks(int i) { return (int)(((unsigned)i * 2654435761u) % 1000000); }
+
+
+static volatile unsigned long checksum_sink;
+
+
+// replay a pattern through the block cache with background prefetch workers
+static void run_executor(const char *name, int fd, int total_blocks, int accesses, int (*next)(int i)) {
+    PerformanceOptimizer *opt = init_performance_optimizer(total_blocks, 4);
+    if (!opt) return;
+    if (start_prefetch_workers(opt, fd, 2) != 0) {
+        destroy_performance_optimizer(opt);
+        return;
+    }
+
+    // the application checksums each block, giving the workers time to run ahead
+    char buffer[BLOCK_SIZE];
+    unsigned long checksum = 0;
+    for (int i = 0; i < accesses; i++) {
+        if (optimizer_read_block(opt, next(i) % total_blocks, buffer) < 0) continue;
+        for (int pass = 0; pass < 4; pass++) {
+            for (int j = 0; j < BLOCK_SIZE; j++) checksum = checksum * 31 + (unsigned char)buffer[j];
+        }
+    }
+    stop_prefetch_workers(opt);
+    checksum_sink = checksum;
+
+    PrefetchStats *st = &opt->executor.stats;
+    printf("%-22s hits %6ld, misses %6ld | prefetched %6ld: used %6ld, wasted %5ld | "
+           "cancelled %5ld, dropped %5ld, deduplicated %6ld\n",
+           name, atomic_load(&st->demand_hits), atomic_load(&st->demand_misses),
+           atomic_load(&st->completed), atomic_load(&st->used), atomic_load(&st->wasted),
+           atomic_load(&st->cancelled), atomic_load(&st->dropped), atomic_load(&st->deduplicated));
+
+    destroy_performance_optimizer(opt);
 }
 
 
 // --- test driver ---
 int main() {
-    PerformanceOptimizer *opt = init_optimizer(100, 3);
+    PerformanceOptimizer *opt = init_performance_optimizer(100, 3);
 
     update_access_pattern(opt, 5);
     update_access_pattern(opt, 6);
     update_access_pattern(opt, 7);
 
-    printf("Prefetch queue (%d): ", opt->prefetch_queue.count);
-    for (int i = 0; i < opt->prefetch_queue.count; i++) {
-        printf("%d ", opt->prefetch_queue.blocks[i]);
+    unsigned long head = atomic_load(&opt->prefetch_queue.head);
+    unsigned long tail = atomic_load(&opt->prefetch_queue.tail);
+    printf("Prefetch queue (%lu): ", tail - head);
+    for (unsigned long i = head; i < tail; i++) {
+        printf("%d ", opt->prefetch_queue.slots[i & opt->prefetch_queue.mask].block);
     }
     printf("\n");
 
-    free(opt->prefetch_queue.blocks);
-    free(opt->metrics.block_access_count);
-    free(opt->metrics.block_access_pattern);
-    free(opt->metrics.block_heat_map);
-    free(opt);
+    destroy_performance_optimizer(opt);
+
+    printf("\nPrefetcher on 1M blocks, 200000 accesses each:\n");
+    run_pattern("sequential", 1000000, 200000, sequential);
+    run_pattern("backward scan", 1000000, 200000, backward);
+    run_pattern("stride 8", 1000000, 200000, strided);
+    run_pattern("3 interleaved streams", 1000000, 200000, interleaved);
+    run_pattern("random", 1000000, 200000, random_blocks);
+
+    // 32 MiB backing file for the executor
+    const int file_blocks = 8192;
+    const char *path = "/tmp/prefetch_demo.dat";
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 1;
+
+    char block[BLOCK_SIZE];
+    for (int i = 0; i < file_blocks; i++) {
+        memset(block, i & 0xFF, sizeof(block));
+        if (write(fd, block, sizeof(block)) != sizeof(block)) break;
+    }
+
+    printf("\nPrefetch executor, 2 workers, %d-block file, 50000 reads each:\n", file_blocks);
+    run_executor("sequential", fd, file_blocks, 50000, sequential);
+    run_executor("backward scan", fd, file_blocks, 50000, backward);
+    run_executor("3 interleaved streams", fd, file_blocks, 50000, interleaved);
+    run_executor("random", fd, file_blocks, 50000, random_blocks);
+
+    close(fd);
+    unlink(path);
+
+    return 0;
 }